@@ -0,0 +1,407 @@
+// cortex_bench: repeatable micro-benchmarks for the hot paths of the shell.
+//
+// Every benchmark runs on synthetic input generated from a fixed seed, so two
+// runs with the same options measure the same work. Results are written as a
+// single JSON document (stdout by default) for comparison between builds.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory_resource>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "core/Environment.hpp"
+#include "shell/CommandContext.hpp"
+#include "shell/CommandRegistry.hpp"
+#include "shell/Parser.hpp"
+#include "shell/Shell.hpp"
+#include "util/Glob.hpp"
+#include "vfs/FolderVfs.hpp"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::uint32_t kSeed = 42;
+
+struct Options {
+    size_t size = 10000;        // items for in-memory benchmarks (tokens, names, lines)
+    size_t files = 500;         // files for filesystem benchmarks
+    size_t file_bytes = 4096;   // bytes per file for pack/unpack
+    int repeat = 7;             // timed repetitions per benchmark
+    std::string filter;         // substring of benchmark names to run
+    std::string out_path;       // JSON destination; empty means stdout
+    bool list_only = false;
+};
+
+struct Result {
+    std::string name;
+    size_t items = 0;
+    size_t bytes = 0;
+    std::vector<double> samples_ns;
+};
+
+struct Bench {
+    std::string name;
+    // Prepares input and returns the body of one repetition. `items` and
+    // `bytes` describe the work done by a single call of the body.
+    std::function<std::function<void()>(size_t& items, size_t& bytes)> setup;
+};
+
+// Discards everything written to it; keeps command output out of timings.
+class NullBuf : public std::streambuf {
+protected:
+    int overflow(int c) override { return c == EOF ? 0 : c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+NullBuf null_buf;
+std::ostream null_out(&null_buf);
+std::istringstream empty_in;
+
+// Volatile sink so the optimizer cannot drop results of pure benchmarks.
+volatile size_t g_sink = 0;
+
+std::string random_word(std::mt19937& rng, size_t min_len, size_t max_len) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_";
+    std::uniform_int_distribution<size_t> len(min_len, max_len);
+    std::uniform_int_distribution<size_t> ch(0, sizeof(alphabet) - 2);
+    std::string s(len(rng), ' ');
+    for (auto& c : s) c = alphabet[ch(rng)];
+    return s;
+}
+
+void write_host_file(const fs::path& p, const std::string& data) {
+    std::ofstream ofs(p, std::ios::binary | std::ios::trunc);
+    ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+// Runs a builtin against the bench VFS with output discarded.
+int run_builtin(IVfs& vfs, Environment& env, const std::vector<std::string>& args) {
+    fs::path cwd = "/";
+    ICommand* cmd = Shell::builtin_registry().find(args[0]);
+    if (!cmd) throw std::runtime_error("unknown builtin: " + args[0]);
+    CommandContext ctx(args, empty_in, null_out, vfs, env, cwd, &Shell::builtin_registry());
+    return cmd->execute(ctx);
+}
+
+std::vector<Bench> make_benches(const Options& opt, FolderVfs& vfs, Environment& env) {
+    std::vector<Bench> benches;
+    const fs::path root = vfs.root();
+
+    // A command line mixing bare words, quoted words, escapes and pipes.
+    auto make_line = [](size_t tokens) {
+        std::mt19937 rng(kSeed);
+        std::string line;
+        for (size_t i = 0; i < tokens; ++i) {
+            if (i) line += ' ';
+            switch (i % 8) {
+            case 3: line += '"' + random_word(rng, 2, 10) + " x\""; break;
+            case 5: line += '|'; break;
+            case 6: line += random_word(rng, 1, 6) + "\\ y"; break;
+            default: line += random_word(rng, 1, 12); break;
+            }
+        }
+        return line;
+    };
+
+    benches.push_back({"parser.split", [&opt, make_line](size_t& items, size_t& bytes) {
+        auto line = std::make_shared<std::string>(make_line(opt.size));
+        items = opt.size; bytes = line->size();
+        return [line] { g_sink = g_sink + Parser::split(*line).size(); };
+    }});
+
+    benches.push_back({"parser.lex", [&opt, make_line](size_t& items, size_t& bytes) {
+        auto line = std::make_shared<std::string>(make_line(opt.size));
+        items = opt.size; bytes = line->size();
+        return [line] {
+            std::pmr::monotonic_buffer_resource arena(4096);
+            g_sink = g_sink + Parser::lex(*line, &arena).size();
+        };
+    }});
+
+    // Words as the lexer hands them to the shell: bare and braced
+    // variables, $?, and quoted or escaped parts around them.
+    benches.push_back({"shell.expand_word", [&opt, &vfs, &env](size_t& items, size_t& bytes) {
+        std::mt19937 rng(kSeed);
+        for (int i = 0; i < 64; ++i) env.set("VAR" + std::to_string(i), random_word(rng, 4, 16));
+        auto line = std::make_shared<std::string>();
+        for (size_t i = 0; i < opt.size; ++i) {
+            const std::string var = "VAR" + std::to_string(i % 64);
+            if (i) *line += ' ';
+            switch (i % 5) {
+            case 0: *line += "$" + var + "/" + random_word(rng, 3, 8); break;
+            case 1: *line += "\"${" + var + "}\"/x"; break;
+            case 2: *line += "$?"; break;
+            case 3: *line += "'$" + var + "'$" + var; break;
+            default: *line += "\\$" + var + random_word(rng, 3, 8); break;
+            }
+        }
+        items = opt.size; bytes = line->size();
+        auto shell = std::make_shared<Shell>(empty_in, null_out, vfs, env);
+        return [line, shell, &env] {
+            std::pmr::monotonic_buffer_resource arena(4096);
+            for (const auto& t : Parser::lex(*line, &arena))
+                if (t.has(Parser::kNeedsExpansion)) g_sink = g_sink + shell->expand_word(t.raw, env, &arena).size();
+        };
+    }});
+
+    benches.push_back({"vfs.resolveSecure", [&opt, &vfs, root](size_t& items, size_t& bytes) {
+        fs::create_directories(root / "resolve" / "a" / "b" / "c");
+        std::mt19937 rng(kSeed);
+        auto paths = std::make_shared<std::vector<fs::path>>();
+        static const char* shapes[] = {"/resolve/a/b/c/", "a/b/", "../resolve/./a/", "/resolve/a/b/../b/c/"};
+        bytes = 0;
+        for (size_t i = 0; i < opt.size; ++i) {
+            paths->emplace_back(std::string(shapes[i % 4]) + random_word(rng, 4, 12));
+            bytes += paths->back().native().size();
+        }
+        items = opt.size;
+        return [paths, &vfs] {
+            const fs::path cwd = "/resolve";
+            for (const auto& p : *paths) g_sink = g_sink + vfs.resolveSecure(cwd, p).native().size();
+        };
+    }});
+
+    benches.push_back({"vfs.list", [&opt, &vfs, root](size_t& items, size_t& bytes) {
+        fs::path dir = root / "list";
+        fs::create_directories(dir);
+        std::mt19937 rng(kSeed);
+        for (size_t i = 0; i < opt.files; ++i) {
+            if (i % 10 == 0) fs::create_directories(dir / ("dir" + std::to_string(i)));
+            else write_host_file(dir / ("file" + std::to_string(i) + ".txt"), random_word(rng, 0, 64));
+        }
+        items = opt.files; bytes = 0;
+        return [dir, &vfs] { g_sink = g_sink + vfs.list(dir).size(); };
+    }});
+
+    benches.push_back({"find.match_glob", [&opt](size_t& items, size_t& bytes) {
+        std::mt19937 rng(kSeed);
+        static const char* exts[] = {".txt", ".log", ".cpp", ".hpp", ".mar"};
+        auto names = std::make_shared<std::vector<std::string>>();
+        bytes = 0;
+        for (size_t i = 0; i < opt.size; ++i) {
+            names->push_back(random_word(rng, 4, 24) + exts[i % 5]);
+            bytes += names->back().size();
+        }
+        items = opt.size;
+        return [names] {
+            static const glob::Pattern pats[] = {
+                glob::Pattern("*.txt"), glob::Pattern("a*b*c*.???"), glob::Pattern("*_?_*.[lt][ox][gt]")};
+            size_t hits = 0;
+            for (const auto& n : *names)
+                for (const auto& p : pats) hits += p.match(n);
+            g_sink = g_sink + hits;
+        };
+    }});
+
+    // One log-like file of `size` lines; about 1% carry the needle.
+    auto grep_setup = [&opt, &vfs, &env, root](std::vector<std::string> flags, std::string pattern) {
+        return [&opt, &vfs, &env, root, flags, pattern](size_t& items, size_t& bytes) {
+            fs::path file = root / "grep.log";
+            if (!fs::exists(file)) {
+                std::mt19937 rng(kSeed);
+                std::string data;
+                for (size_t i = 0; i < opt.size; ++i) {
+                    data += "2024-01-01T00:00:00 worker-" + std::to_string(i % 16) + ' ';
+                    for (int w = 0; w < 5; ++w) data += random_word(rng, 2, 8) + ' ';
+                    if (i % 100 == 7) data += (i % 200 == 7) ? "NeedleValue" : "needlevalue";
+                    data += '\n';
+                }
+                write_host_file(file, data);
+            }
+            items = opt.size; bytes = static_cast<size_t>(fs::file_size(file));
+            std::vector<std::string> args{"grep", "-n"};
+            args.insert(args.end(), flags.begin(), flags.end());
+            args.push_back(pattern);
+            args.push_back("/grep.log");
+            return [args, &vfs, &env] { run_builtin(vfs, env, args); };
+        };
+    };
+    benches.push_back({"grep.scan", grep_setup({}, "needlevalue")});
+    benches.push_back({"grep.scan_i", grep_setup({"-i"}, "needlevalue")});
+    // With a required literal ("eedle") the DFA only sees candidate lines;
+    // without one it runs over every byte.
+    benches.push_back({"grep.scan_E", grep_setup({"-E"}, "[Nn]eedle(value|Value)$")});
+    // 100 signatures in one Aho-Corasick pass (grep -e ... -e ...)
+    std::vector<std::string> signatures;
+    {
+        std::mt19937 rng(kSeed + 1);
+        for (int i = 0; i < 99; ++i) { signatures.push_back("-e"); signatures.push_back("sig" + random_word(rng, 6, 10)); }
+        signatures.push_back("-e");
+    }
+    benches.push_back({"grep.scan_multi", grep_setup(signatures, "needlevalue")});
+    benches.push_back({"grep.scan_E_dfa", grep_setup({"-E"}, "(worker|thread)-[0-9]+ [a-z]+ (needle|haystack)")});
+
+    // `files` files of `file_bytes` each, spread over ten directories.
+    auto ensure_pack_tree = [&opt, root] {
+        fs::path src = root / "packsrc";
+        if (fs::exists(src)) return;
+        std::mt19937 rng(kSeed);
+        std::uniform_int_distribution<int> byte(0, 255);
+        for (size_t i = 0; i < opt.files; ++i) {
+            fs::path dir = src / ("d" + std::to_string(i % 10));
+            fs::create_directories(dir);
+            std::string data(opt.file_bytes, '\0');
+            for (auto& c : data) c = static_cast<char>(byte(rng));
+            write_host_file(dir / ("f" + std::to_string(i) + ".bin"), data);
+        }
+    };
+
+    benches.push_back({"miniarch.pack", [&opt, &vfs, &env, ensure_pack_tree](size_t& items, size_t& bytes) {
+        ensure_pack_tree();
+        items = opt.files; bytes = opt.files * opt.file_bytes;
+        return [&vfs, &env] { run_builtin(vfs, env, {"pack", "/packsrc", "-o", "/bench.mar"}); };
+    }});
+
+    benches.push_back({"miniarch.unpack", [&opt, &vfs, &env, ensure_pack_tree](size_t& items, size_t& bytes) {
+        ensure_pack_tree();
+        run_builtin(vfs, env, {"pack", "/packsrc", "-o", "/bench.mar"});
+        items = opt.files; bytes = opt.files * opt.file_bytes;
+        return [&vfs, &env] { run_builtin(vfs, env, {"unpack", "/bench.mar", "-C", "/unpacked"}); };
+    }});
+
+    return benches;
+}
+
+Result run_one(const Bench& b, const Options& opt) {
+    Result r;
+    r.name = b.name;
+    auto body = b.setup(r.items, r.bytes);
+    body(); // warm-up: page cache, lazy command construction
+    for (int i = 0; i < opt.repeat; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        body();
+        auto t1 = std::chrono::steady_clock::now();
+        r.samples_ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+    return r;
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (static_cast<unsigned char>(c) < 0x20) out += ' ';
+        else out += c;
+    }
+    return out;
+}
+
+void write_json(std::ostream& os, const Options& opt, const std::vector<Result>& results) {
+    os << "{\n  \"context\": {\"size\": " << opt.size << ", \"files\": " << opt.files
+       << ", \"file_bytes\": " << opt.file_bytes << ", \"repeat\": " << opt.repeat
+       << ", \"seed\": " << kSeed << "},\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        auto sorted = r.samples_ns;
+        std::sort(sorted.begin(), sorted.end());
+        double min = sorted.front();
+        double median = sorted[sorted.size() / 2];
+        double mean = 0;
+        for (double s : sorted) mean += s;
+        mean /= static_cast<double>(sorted.size());
+        double secs = median / 1e9;
+        os << (i ? ",\n" : "\n") << "    {\"name\": \"" << json_escape(r.name) << "\""
+           << ", \"items\": " << r.items << ", \"bytes\": " << r.bytes
+           << ", \"repetitions\": " << sorted.size()
+           << ", \"min_ns\": " << static_cast<std::uint64_t>(min)
+           << ", \"median_ns\": " << static_cast<std::uint64_t>(median)
+           << ", \"mean_ns\": " << static_cast<std::uint64_t>(mean)
+           << ", \"ns_per_item\": " << (r.items ? median / static_cast<double>(r.items) : 0.0)
+           << ", \"items_per_second\": " << (secs > 0 ? static_cast<double>(r.items) / secs : 0.0)
+           << ", \"bytes_per_second\": " << (secs > 0 ? static_cast<double>(r.bytes) / secs : 0.0)
+           << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+void print_usage() {
+    std::cerr << "Usage: cortex_bench [--size N] [--files N] [--file-bytes N] [--repeat N]\n"
+                 "                    [--filter SUBSTR] [--out FILE] [--list]\n";
+}
+
+bool parse_count(const char* s, size_t& out) {
+    char* end = nullptr;
+    unsigned long long v = std::strtoull(s, &end, 10);
+    if (!end || *end || v == 0) return false;
+    out = static_cast<size_t>(v);
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool has_value = i + 1 < argc;
+        size_t n = 0;
+        if (a == "--list") { opt.list_only = true; continue; }
+        if (!has_value) { print_usage(); return 2; }
+        const char* v = argv[++i];
+        if (a == "--size" && parse_count(v, n)) opt.size = n;
+        else if (a == "--files" && parse_count(v, n)) opt.files = n;
+        else if (a == "--file-bytes" && parse_count(v, n)) opt.file_bytes = n;
+        else if (a == "--repeat" && parse_count(v, n)) opt.repeat = static_cast<int>(n);
+        else if (a == "--filter") opt.filter = v;
+        else if (a == "--out") opt.out_path = v;
+        else { print_usage(); return 2; }
+    }
+
+#ifdef _WIN32
+    fs::path root = fs::temp_directory_path() / "cortex_bench";
+#else
+    fs::path root = fs::temp_directory_path() / ("cortex_bench." + std::to_string(::getpid()));
+#endif
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root);
+
+    FolderVfs vfs(root);
+    Environment env;
+    auto benches = make_benches(opt, vfs, env);
+
+    if (opt.list_only) {
+        for (const auto& b : benches) std::cout << b.name << '\n';
+        fs::remove_all(root, ec);
+        return 0;
+    }
+
+    std::vector<Result> results;
+    int rc = 0;
+    try {
+        for (const auto& b : benches) {
+            if (!opt.filter.empty() && b.name.find(opt.filter) == std::string::npos) continue;
+            std::cerr << "running " << b.name << "..." << std::endl;
+            results.push_back(run_one(b, opt));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "cortex_bench: " << e.what() << std::endl;
+        rc = 1;
+    }
+    fs::remove_all(root, ec);
+    if (rc) return rc;
+
+    if (opt.out_path.empty()) {
+        write_json(std::cout, opt, results);
+    } else {
+        std::ofstream ofs(opt.out_path);
+        if (!ofs) { std::cerr << "cortex_bench: cannot write " << opt.out_path << std::endl; return 1; }
+        write_json(ofs, opt, results);
+    }
+    return 0;
+}
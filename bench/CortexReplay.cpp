@@ -0,0 +1,415 @@
+// cortex-replay: end-to-end macro-benchmark that replays a recorded command
+// log against a private copy of a VFS root.
+//
+// The log is JSON Lines, one object per command. The command text is read
+// from the "command" field and the owning session from "session" (both names
+// are configurable). Commands of one session run in log order on one Shell,
+// so cwd and variables carry over as they did when recorded. Separate
+// sessions are spread across worker threads. A line without a session is a
+// session of its own.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/Environment.hpp"
+#include "shell/Parser.hpp"
+#include "shell/Shell.hpp"
+#include "vfs/FolderVfs.hpp"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    fs::path log_path;
+    fs::path root = fs::current_path() / "data" / "rootfs";
+    std::string command_field = "command";
+    std::string session_field = "session";
+    unsigned jobs = 1;
+    unsigned repeat = 1;
+    bool json = false;
+    bool keep = false;
+};
+
+struct Session {
+    std::vector<std::string> commands;
+};
+
+struct Sample {
+    std::string type;
+    double micros;
+    int status;
+};
+
+// Discards everything written to it; command output is not part of the
+// measurement beyond the cost of formatting it.
+class NullBuf : public std::streambuf {
+protected:
+    int overflow(int c) override { return c == EOF ? 0 : c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Just enough JSON to read flat objects: string values are decoded, other
+// scalars are kept as their literal text, nested values are skipped.
+class FlatJson {
+public:
+    explicit FlatJson(const std::string& text) : s_(text) {}
+
+    bool parse(std::map<std::string, std::string>& out) {
+        ws();
+        if (!eat('{')) return false;
+        ws();
+        if (eat('}')) return true;
+        while (true) {
+            std::string key, value;
+            ws();
+            if (!string(key)) return false;
+            ws();
+            if (!eat(':')) return false;
+            ws();
+            if (!this->value(value)) return false;
+            out[key] = value;
+            ws();
+            if (eat(',')) continue;
+            return eat('}');
+        }
+    }
+
+private:
+    const std::string& s_;
+    size_t i_ = 0;
+
+    void ws() { while (i_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[i_]))) ++i_; }
+    bool eat(char c) { if (i_ < s_.size() && s_[i_] == c) { ++i_; return true; } return false; }
+
+    static void put_utf8(std::string& out, unsigned cp) {
+        if (cp < 0x80) out += static_cast<char>(cp);
+        else if (cp < 0x800) { out += static_cast<char>(0xC0 | (cp >> 6)); out += static_cast<char>(0x80 | (cp & 0x3F)); }
+        else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool hex4(unsigned& cp) {
+        if (i_ + 4 > s_.size()) return false;
+        cp = 0;
+        for (int k = 0; k < 4; ++k) {
+            char c = s_[i_++];
+            cp <<= 4;
+            if (c >= '0' && c <= '9') cp |= static_cast<unsigned>(c - '0');
+            else if (c >= 'a' && c <= 'f') cp |= static_cast<unsigned>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') cp |= static_cast<unsigned>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    bool string(std::string& out) {
+        if (!eat('"')) return false;
+        while (i_ < s_.size()) {
+            char c = s_[i_++];
+            if (c == '"') return true;
+            if (c != '\\') { out += c; continue; }
+            if (i_ >= s_.size()) return false;
+            char e = s_[i_++];
+            switch (e) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                unsigned cp = 0;
+                if (!hex4(cp)) return false;
+                if (cp >= 0xD800 && cp < 0xDC00 && i_ + 1 < s_.size() && s_[i_] == '\\' && s_[i_ + 1] == 'u') {
+                    i_ += 2;
+                    unsigned lo = 0;
+                    if (!hex4(lo)) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                put_utf8(out, cp);
+                break;
+            }
+            default: out += e; break;
+            }
+        }
+        return false;
+    }
+
+    bool value(std::string& out) {
+        if (i_ < s_.size() && s_[i_] == '"') return string(out);
+        if (i_ < s_.size() && (s_[i_] == '{' || s_[i_] == '[')) {
+            // Skip nested structures; only top-level scalars are used.
+            int depth = 0;
+            bool in_str = false;
+            for (; i_ < s_.size(); ++i_) {
+                char c = s_[i_];
+                if (in_str) {
+                    if (c == '\\') ++i_;
+                    else if (c == '"') in_str = false;
+                } else if (c == '"') in_str = true;
+                else if (c == '{' || c == '[') ++depth;
+                else if ((c == '}' || c == ']') && --depth == 0) { ++i_; return true; }
+            }
+            return false;
+        }
+        size_t start = i_;
+        while (i_ < s_.size() && s_[i_] != ',' && s_[i_] != '}' && !std::isspace(static_cast<unsigned char>(s_[i_]))) ++i_;
+        out = s_.substr(start, i_ - start);
+        return i_ > start;
+    }
+};
+
+// Command type used for grouping: the first word that is not a KEY=VALUE
+// assignment, with `time`/`timeout N` prefixes looked through.
+std::string command_type(const std::string& text) {
+    auto first_line = text.substr(0, text.find('\n'));
+    auto tokens = Parser::split(first_line);
+    size_t i = 0;
+    while (i < tokens.size()) {
+        const auto& t = tokens[i];
+        if (t.find('=') != std::string::npos && t.front() != '=') { ++i; continue; }
+        if (t == "time") { ++i; continue; }
+        if (t == "timeout" && i + 2 < tokens.size()) { i += 2; continue; }
+        break;
+    }
+    if (i >= tokens.size()) return tokens.empty() ? "(empty)" : "(assign)";
+    return tokens[i];
+}
+
+long peak_rss_kib() {
+#ifndef _WIN32
+    struct rusage ru {};
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#ifdef __APPLE__
+        return static_cast<long>(ru.ru_maxrss / 1024);
+#else
+        return static_cast<long>(ru.ru_maxrss);
+#endif
+    }
+#endif
+    return -1;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    // Nearest-rank definition
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+    if (rank == 0) rank = 1;
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+bool load_log(const Options& opt, std::vector<Session>& sessions, std::string& error) {
+    std::ifstream ifs(opt.log_path);
+    if (!ifs) { error = "cannot open " + opt.log_path.string(); return false; }
+    std::unordered_map<std::string, size_t> by_id;
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(ifs, line)) {
+        ++line_no;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::map<std::string, std::string> obj;
+        if (!FlatJson(line).parse(obj)) {
+            error = opt.log_path.string() + ":" + std::to_string(line_no) + ": invalid JSON object";
+            return false;
+        }
+        auto cmd = obj.find(opt.command_field);
+        if (cmd == obj.end()) continue;
+        auto sid = obj.find(opt.session_field);
+        if (sid == obj.end()) {
+            sessions.push_back({{cmd->second}});
+            continue;
+        }
+        auto [it, inserted] = by_id.emplace(sid->second, sessions.size());
+        if (inserted) sessions.emplace_back();
+        sessions[it->second].commands.push_back(cmd->second);
+    }
+    return true;
+}
+
+void print_usage() {
+    std::cerr << "Usage: cortex-replay LOG.jsonl [--root DIR] [--jobs N] [--repeat N]\n"
+                 "                     [--field NAME] [--session-field NAME] [--json] [--keep]\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        auto count = [&](unsigned& out) {
+            const char* v = next();
+            if (!v) return false;
+            long n = std::strtol(v, nullptr, 10);
+            if (n <= 0) return false;
+            out = static_cast<unsigned>(n);
+            return true;
+        };
+        bool ok = true;
+        if (a == "--root") { const char* v = next(); ok = v; if (v) opt.root = v; }
+        else if (a == "--jobs" || a == "-j") ok = count(opt.jobs);
+        else if (a == "--repeat") ok = count(opt.repeat);
+        else if (a == "--field") { const char* v = next(); ok = v; if (v) opt.command_field = v; }
+        else if (a == "--session-field") { const char* v = next(); ok = v; if (v) opt.session_field = v; }
+        else if (a == "--json") opt.json = true;
+        else if (a == "--keep") opt.keep = true;
+        else if (opt.log_path.empty() && !a.empty() && a[0] != '-') opt.log_path = a;
+        else ok = false;
+        if (!ok) { print_usage(); return 2; }
+    }
+    if (opt.log_path.empty()) { print_usage(); return 2; }
+
+    std::vector<Session> sessions;
+    std::string error;
+    if (!load_log(opt, sessions, error)) { std::cerr << "cortex-replay: " << error << std::endl; return 1; }
+    if (sessions.empty()) {
+        std::cerr << "cortex-replay: no '" << opt.command_field << "' entries in " << opt.log_path.string() << std::endl;
+        return 1;
+    }
+
+    // Every replay gets a private copy so mutating commands cannot leak
+    // into the source tree or into the next run.
+#ifdef _WIN32
+    fs::path copy = fs::temp_directory_path() / "cortex_replay";
+#else
+    fs::path copy = fs::temp_directory_path() / ("cortex_replay." + std::to_string(::getpid()));
+#endif
+    std::error_code ec;
+    fs::remove_all(copy, ec);
+    fs::create_directories(copy, ec);
+    if (fs::is_directory(opt.root, ec)) {
+        fs::copy(opt.root, copy, fs::copy_options::recursive | fs::copy_options::copy_symlinks, ec);
+        if (ec) { std::cerr << "cortex-replay: copying " << opt.root.string() << ": " << ec.message() << std::endl; return 1; }
+    } else {
+        std::cerr << "cortex-replay: " << opt.root.string() << " not found, starting from an empty VFS" << std::endl;
+    }
+
+    FolderVfs vfs(copy);
+    (void)Shell::builtin_registry();
+
+    // Work items are (repeat, session) pairs handed out in log order.
+    const size_t total_items = sessions.size() * opt.repeat;
+    std::atomic<size_t> next_item{0};
+    std::vector<std::vector<Sample>> per_worker(opt.jobs);
+
+    auto worker = [&](unsigned id) {
+        NullBuf null_buf;
+        std::ostream out(&null_buf);
+        std::istringstream no_input;
+        auto& samples = per_worker[id];
+        for (size_t item; (item = next_item.fetch_add(1)) < total_items; ) {
+            const Session& session = sessions[item % sessions.size()];
+            Environment env;
+            Shell shell(no_input, out, vfs, env);
+            for (const auto& cmd : session.commands) {
+                auto t0 = std::chrono::steady_clock::now();
+                int rc = shell.run_command(cmd);
+                auto t1 = std::chrono::steady_clock::now();
+                samples.push_back({command_type(cmd), std::chrono::duration<double, std::micro>(t1 - t0).count(), rc});
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned j = 1; j < opt.jobs; ++j) threads.emplace_back(worker, j);
+    worker(0);
+    for (auto& t : threads) t.join();
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    struct TypeStats { std::vector<double> micros; size_t failures = 0; };
+    std::map<std::string, TypeStats> by_type;
+    std::vector<double> all;
+    size_t failures = 0;
+    for (const auto& samples : per_worker) {
+        for (const auto& s : samples) {
+            auto& ts = by_type[s.type];
+            ts.micros.push_back(s.micros);
+            all.push_back(s.micros);
+            if (s.status != 0) { ++ts.failures; ++failures; }
+        }
+    }
+    for (auto& [type, ts] : by_type) std::sort(ts.micros.begin(), ts.micros.end());
+    std::sort(all.begin(), all.end());
+
+    const double throughput = wall_s > 0 ? static_cast<double>(all.size()) / wall_s : 0;
+    const long rss = peak_rss_kib();
+
+    if (opt.json) {
+        auto row = [](std::ostream& os, const std::vector<double>& v, size_t fails) {
+            os << "\"count\": " << v.size() << ", \"failed\": " << fails
+               << ", \"p50_us\": " << percentile(v, 50) << ", \"p90_us\": " << percentile(v, 90)
+               << ", \"p99_us\": " << percentile(v, 99) << ", \"max_us\": " << (v.empty() ? 0 : v.back());
+        };
+        std::cout << "{\n  \"sessions\": " << sessions.size() << ", \"jobs\": " << opt.jobs
+                  << ", \"repeat\": " << opt.repeat << ", \"commands\": " << all.size()
+                  << ", \"wall_s\": " << wall_s << ", \"commands_per_second\": " << throughput
+                  << ", \"peak_rss_kib\": " << rss << ",\n  \"all\": {";
+        row(std::cout, all, failures);
+        std::cout << "},\n  \"by_command\": {";
+        bool first = true;
+        for (const auto& [type, ts] : by_type) {
+            std::cout << (first ? "\n" : ",\n") << "    \"";
+            for (char c : type) {
+                if (c == '"' || c == '\\') std::cout << '\\' << c;
+                else if (static_cast<unsigned char>(c) >= 0x20) std::cout << c;
+            }
+            std::cout << "\": {";
+            row(std::cout, ts.micros, ts.failures);
+            std::cout << "}";
+            first = false;
+        }
+        std::cout << "\n  }\n}\n";
+    } else {
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "replayed " << all.size() << " commands from " << sessions.size() << " sessions"
+                  << " (jobs " << opt.jobs << ", repeat " << opt.repeat << ") in "
+                  << std::setprecision(3) << wall_s << " s\n" << std::setprecision(1)
+                  << "throughput " << throughput << " commands/s, peak RSS " << rss << " KiB\n\n";
+        std::cout << std::left << std::setw(16) << "command" << std::right
+                  << std::setw(8) << "count" << std::setw(8) << "failed"
+                  << std::setw(12) << "p50_us" << std::setw(12) << "p90_us"
+                  << std::setw(12) << "p99_us" << std::setw(12) << "max_us" << '\n';
+        auto print_row = [](const std::string& name, const std::vector<double>& v, size_t fails) {
+            std::cout << std::left << std::setw(16) << name.substr(0, 15) << std::right
+                      << std::setw(8) << v.size() << std::setw(8) << fails
+                      << std::setw(12) << percentile(v, 50) << std::setw(12) << percentile(v, 90)
+                      << std::setw(12) << percentile(v, 99) << std::setw(12) << (v.empty() ? 0 : v.back()) << '\n';
+        };
+        for (const auto& [type, ts] : by_type) print_row(type, ts.micros, ts.failures);
+        print_row("(all)", all, failures);
+    }
+
+    if (opt.keep) std::cerr << "cortex-replay: VFS copy kept at " << copy.string() << std::endl;
+    else fs::remove_all(copy, ec);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "../shell/CommandRegistry.hpp"
+
+// Factories for every builtin command and the table that registers them.
+// Kept out of main.cpp so other executables (cortex_bench) can link it.
+
+namespace Builtins {
+    std::unique_ptr<ICommand> make_pwd();
+    std::unique_ptr<ICommand> make_cd();
+    std::unique_ptr<ICommand> make_ls();
+    std::unique_ptr<ICommand> make_echo();
+    std::unique_ptr<ICommand> make_mkdir();
+    std::unique_ptr<ICommand> make_touch();
+    std::unique_ptr<ICommand> make_cat();
+    std::unique_ptr<ICommand> make_rm();
+    std::unique_ptr<ICommand> make_cp();
+    std::unique_ptr<ICommand> make_mv();
+    std::unique_ptr<ICommand> make_env();
+    std::unique_ptr<ICommand> make_set();
+    std::unique_ptr<ICommand> make_unset();
+    std::unique_ptr<ICommand> make_help();
+    std::unique_ptr<ICommand> make_version();
+    std::unique_ptr<ICommand> make_stat();
+    std::unique_ptr<ICommand> make_clear();
+    std::unique_ptr<ICommand> make_head();
+    std::unique_ptr<ICommand> make_tail();
+    std::unique_ptr<ICommand> make_find();
+    std::unique_ptr<ICommand> make_grep();
+    std::unique_ptr<ICommand> make_index();
+    std::unique_ptr<ICommand> make_locate();
+    std::unique_ptr<ICommand> make_updatedb();
+    std::unique_ptr<ICommand> make_pack();
+    std::unique_ptr<ICommand> make_unpack();
+    std::unique_ptr<ICommand> make_chmod();
+    std::unique_ptr<ICommand> make_test();
+    std::unique_ptr<ICommand> make_bracket();
+    std::unique_ptr<ICommand> make_pkg();
+    std::unique_ptr<ICommand> make_timeout();
+}
+
+namespace Builtins {
+    void register_all(CommandRegistry& reg) {
+        reg.add("pwd", make_pwd);
+        reg.add("cd", make_cd);
+        reg.add("ls", make_ls);
+        reg.add("echo", make_echo);
+        reg.add("mkdir", make_mkdir);
+        reg.add("touch", make_touch);
+        reg.add("cat", make_cat);
+        reg.add("rm", make_rm);
+        reg.add("cp", make_cp);
+        reg.add("mv", make_mv);
+        reg.add("env", make_env);
+        reg.add("set", make_set);
+        reg.add("unset", make_unset);
+        reg.add("help", make_help);
+        reg.add("version", make_version);
+        reg.add("stat", make_stat);
+        reg.add("clear", make_clear);
+        reg.add("head", make_head);
+        reg.add("tail", make_tail);
+        reg.add("find", make_find);
+        reg.add("grep", make_grep);
+        reg.add("index", make_index);
+        reg.add("locate", make_locate);
+        reg.add("updatedb", make_updatedb);
+        reg.add("pack", make_pack);
+        reg.add("unpack", make_unpack);
+        reg.add("chmod", make_chmod);
+        reg.add("test", make_test);
+        reg.add("[", make_bracket);
+        reg.add("pkg", make_pkg);
+        reg.add("timeout", make_timeout);
+    }
+}
@@ -2,6 +2,56 @@
 #include "../shell/CommandContext.hpp"
 #include "../vfs/IVfs.hpp"
 #include "Helpers.hpp"
+#include "../core/IoStats.hpp"
+#include "../core/OutputSink.hpp"
+#include <algorithm>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+enum class Copy { Done, Fallback, Interrupted };
+
+// Kernel-side copy of a regular host file to the sink's descriptor. Falls
+// back (before writing anything) when the file or descriptor does not
+// support sendfile, so the caller can take the buffered path instead.
+Copy send_file(const std::filesystem::path& host, CommandContext& ctx) {
+#ifdef __linux__
+    int in_fd = ::open(host.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in_fd < 0) return Copy::Fallback;
+    struct stat st {};
+    if (::fstat(in_fd, &st) != 0 || !S_ISREG(st.st_mode)) { ::close(in_fd); return Copy::Fallback; }
+    ctx.sink->flush();
+    // Chunked so a large copy still notices Ctrl+C and timeouts
+    constexpr size_t kChunk = 1 << 20;
+    off_t offset = 0;
+    Copy result = Copy::Done;
+    while (offset < st.st_size) {
+        if (ctx.cancel.cancelled()) { result = Copy::Interrupted; break; }
+        size_t want = std::min(kChunk, static_cast<size_t>(st.st_size - offset));
+        ssize_t n = ::sendfile(ctx.sink->fd(), in_fd, &offset, want);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (offset == 0) result = Copy::Fallback;
+            break;
+        }
+    }
+    ::close(in_fd);
+    IoStats::add_read(static_cast<std::uint64_t>(offset));
+    return result;
+#else
+    (void)host; (void)ctx;
+    return Copy::Fallback;
+#endif
+}
+
+}
 
 class Cat : public ICommand {
 public:
@@ -11,7 +61,9 @@ public:
 Synopsis:
   cat [file]
 Notes:
-  When no file is provided, reads from standard input.
+  When no file is provided, reads from standard input. A file printed
+  straight to the shell's output (no pipe or redirect) is copied by the
+  kernel without passing through the shell's buffers.
 Examples:
   cat a.txt
   cat < a.txt
@@ -22,6 +74,7 @@ Examples:
             std::string line;
             // Read all from stdin until EOF
             while (std::getline(ctx.in, line)) {
+                if (ctx.cancel.cancelled()) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
                 ctx.out << line;
                 if (!ctx.in.eof()) ctx.out << '\n';
             }
@@ -29,7 +82,19 @@ Examples:
         } else {
             try {
                 auto abs = ctx.vfs.resolveSecure(ctx.cwd, to_vfs_path(ctx.args[1]));
-                ctx.out << ctx.vfs.readFile(abs);
+                if (ctx.sink) {
+                    // Straight to the terminal or stdout: no user-space copy
+                    auto copied = send_file(abs, ctx);
+                    if (copied == Copy::Interrupted) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
+                    if (copied == Copy::Done) return 0;
+                }
+                auto data = ctx.vfs.readFile(abs);
+                // Write in chunks so a large file can be interrupted mid-way
+                constexpr size_t kChunk = 64 * 1024;
+                for (size_t off = 0; off < data.size(); off += kChunk) {
+                    if (ctx.cancel.cancelled()) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
+                    ctx.out.write(data.data() + off, (std::streamsize)std::min(kChunk, data.size() - off));
+                }
                 return 0;
             } catch (const std::exception& e) {
                 ctx.out << "cat: " << e.what() << std::endl;
@@ -2,6 +2,10 @@
 #include "../shell/CommandContext.hpp"
 #include "../vfs/IVfs.hpp"
 #include "Helpers.hpp"
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
 
 class Cp : public ICommand {
 public:
@@ -27,7 +31,26 @@ Examples:
         try {
             auto src = ctx.vfs.resolveSecure(ctx.cwd, to_vfs_path(ctx.args[idx]));
             auto dst = ctx.vfs.resolveSecure(ctx.cwd, to_vfs_path(ctx.args[idx+1]));
-            ctx.vfs.copy(src, dst, recursive);
+            std::error_code ec;
+            if (!recursive || !fs::is_directory(src, ec)) {
+                ctx.vfs.copy(src, dst, recursive);
+                return 0;
+            }
+            // Walk the tree here rather than in one IVfs::copy call so the
+            // copy can be cancelled between entries.
+            ctx.vfs.mkdir(dst, true);
+            fs::recursive_directory_iterator it(src, fs::directory_options::skip_permission_denied, ec), end;
+            for (; it != end; it.increment(ec)) {
+                if (ctx.cancel.cancelled()) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
+                auto target = dst / it->path().lexically_relative(src);
+                std::error_code type_ec;
+                // A link is copied as a link; is_directory() would follow it
+                // and the iterator does not, leaving an empty directory
+                if (it->is_symlink(type_ec)) ctx.vfs.copy(it->path(), target, true);
+                else if (it->is_directory(type_ec)) ctx.vfs.mkdir(target, true);
+                else ctx.vfs.copy(it->path(), target, false);
+            }
+            if (ec) { ctx.out << "cp: " << ec.message() << std::endl; return 1; }
             return 0;
         } catch (const std::exception& e) {
             ctx.out << "cp: " << e.what() << std::endl;
@@ -1,22 +1,46 @@
 #include "../shell/ICommand.hpp"
 #include "../shell/CommandContext.hpp"
+#include "../shell/CommandRegistry.hpp"
 #include "../vfs/IVfs.hpp"
+#include "../core/IoStats.hpp"
 #include "Helpers.hpp"
-#include "../core/Interrupt.hpp"
+#include "../util/Glob.hpp"
+#include "../util/Walk.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
 #include <system_error>
+#include <thread>
+#include <vector>
+
+// With --unordered, a worker hands its output to the printing thread in
+// batches of about this size.
+static constexpr size_t kOutputBatch = 64 * 1024;
+// -exec ... {} + runs its command once per this many paths.
+static constexpr size_t kExecBatch = 1024;
+
+namespace {
+
+struct FindOptions {
+    std::string name_pat;              // -name
+    char type_filter = 0;              // -type: 0, 'f', 'd', 'l'
+    long long size_filter = LLONG_MIN; // -size; LLONG_MIN when absent
+    int size_mode = 0;                 // -1: <, 0: ==, +1: >
+    int maxdepth = INT_MAX;            // -maxdepth
+    long long mtime_days = LLONG_MIN;  // -mtime; LLONG_MIN when absent
+    int mtime_mode = 0;                // -1: <, 0: ==, +1: >
+    std::int64_t newer = INT64_MIN;    // -newer: the file's mtime, ns
+    std::vector<std::string> exec;     // -exec: the command and its leading arguments
+    bool remove = false;               // -delete
+    unsigned jobs = 0;                 // -j; 0 picks the hardware thread count
+    bool unordered = false;            // --unordered
+};
 
-static bool match_glob(const std::string& name, const std::string& pat) {
-    // Very simple glob: * and ? only, no character classes
-    size_t n = 0, p = 0, star = std::string::npos, match = 0;
-    while (n < name.size()) {
-        if (p < pat.size() && (pat[p] == '?' || pat[p] == name[n])) { ++n; ++p; }
-        else if (p < pat.size() && pat[p] == '*') { star = p++; match = n; }
-        else if (star != std::string::npos) { p = star + 1; n = ++match; }
-        else return false;
-    }
-    while (p < pat.size() && pat[p] == '*') ++p;
-    return p == pat.size();
 }
 
 class Find : public ICommand {
@@ -25,31 +49,55 @@ public:
     std::string help() const override {
         return R"(find: search for files in a directory hierarchy
 Synopsis:
-  find <path> [-name PAT] [-type f|d] [-size +N|-N|N] [-maxdepth D]
+  find <path> [-name PAT] [-type f|d|l] [-size +N|-N|N] [-mtime +N|-N|N]
+       [-newer FILE] [-maxdepth D] [-j N] [--unordered] [-delete]
+       [-exec CMD [ARGS...] {} +]
 Options:
-  -name PAT     Filter by glob pattern on basename (* and ? supported)
-  -type f|d     Filter by type: f=file, d=directory
+  -name PAT     Filter by glob pattern on basename (*, ? and [...] supported)
+  -type f|d|l   Filter by type: f=file, d=directory, l=symlink
   -size +/-N|N  File size in bytes: + greater than, - less than, exact otherwise
+  -mtime +/-N|N Modified more than, less than or exactly N days ago
+                (the age in whole days, rounded down)
+  -newer FILE   Modified more recently than FILE
   -maxdepth D   Descend at most D levels (0 means only the start path)
+  -j N          Read directories on N threads (default: one per CPU)
+  --unordered   Print paths as they are found instead of sorted
+Actions (instead of printing):
+  -exec CMD [ARGS...] {} +
+                Run CMD ARGS... with the matching paths appended, in
+                batches of up to 1024 paths, as the walk finds them.
+                Each batch is sorted; with more than one, which paths
+                share a batch follows the walk and so -j
+  -delete       Remove matching files and directories, deepest first; a
+                directory that still has entries is not removed, and
+                the start path itself never is (so not '.' or '/')
 Notes:
-  Symlinks are not followed for recursion in MVP.
+  Output is sorted by path, each directory followed by its contents, so it
+  does not depend on -j. --unordered starts printing at once and keeps
+  memory flat on huge trees.
+  Symlinks are reported as such (-type l), never followed nor matched by
+  -type f or -type d; only a start path that is a link is followed.
+  Only -size, -mtime and -newer need a stat per entry; other filters use
+  what the directory listing reports.
+  -exec runs CMD in this shell, without starting a process or parsing a
+  command line; it may be any builtin. The exit status is 1 if a run of
+  CMD or a removal failed.
 Examples:
   find . -name "*.txt" -maxdepth 1
   find /projects -type f -size +1024
+  find / -name "*.log" --unordered
+  find /logs -name "*.log" -mtime +7 -delete
+  find /src -name "*.h" -newer /src/build.stamp -exec grep -l TODO {} +
 )";
     }
     int execute(CommandContext& ctx) override {
         if (ctx.args.size() == 1) {
-            ctx.out << "find: common usage\n  find <path> [-name PAT] [-type f|d] [-maxdepth D]\nUse 'help find' for full help." << std::endl;
+            ctx.out << "find: common usage\n  find <path> [-name PAT] [-type f|d|l] [-maxdepth D] [-exec CMD {} +]\nUse 'help find' for full help." << std::endl;
             return 0;
         }
         namespace fs = std::filesystem;
         fs::path start{"."};
-        std::string name_pat;
-        char type_filter = 0; // 0, 'f', 'd'
-        long long size_filter = LLONG_MIN; // use sentinel
-        int size_mode = 0; // -1: <, 0: ==, +1: >
-        int maxdepth = INT_MAX;
+        FindOptions opt;
 
         size_t i = 1;
         if (i < ctx.args.size() && ctx.args[i].rfind("-", 0) != 0) {
@@ -57,68 +105,235 @@ Examples:
         }
         for (; i < ctx.args.size(); ++i) {
             const auto& a = ctx.args[i];
-            if (a == "-name" && i + 1 < ctx.args.size()) { name_pat = ctx.args[++i]; continue; }
-            if (a == "-type" && i + 1 < ctx.args.size()) { char t = ctx.args[++i][0]; if (t=='f'||t=='d') type_filter=t; continue; }
-            if (a == "-size" && i + 1 < ctx.args.size()) {
-                std::string s = ctx.args[++i];
-                if (!s.empty() && (s[0] == '+' || s[0] == '-')) { size_mode = (s[0] == '+') ? +1 : -1; s = s.substr(1); }
-                size_filter = std::stoll(s);
-                continue;
+            try {
+                if (a == "--unordered") { opt.unordered = true; continue; }
+                if (a == "-name" && i + 1 < ctx.args.size()) { opt.name_pat = ctx.args[++i]; continue; }
+                if (a == "-type" && i + 1 < ctx.args.size()) { char t = ctx.args[++i][0]; if (t=='f'||t=='d'||t=='l') opt.type_filter=t; continue; }
+                if (a == "-size" && i + 1 < ctx.args.size()) {
+                    std::string s = ctx.args[++i];
+                    if (!s.empty() && (s[0] == '+' || s[0] == '-')) { opt.size_mode = (s[0] == '+') ? +1 : -1; s = s.substr(1); }
+                    opt.size_filter = std::stoll(s);
+                    continue;
+                }
+                if (a == "-maxdepth" && i + 1 < ctx.args.size()) { opt.maxdepth = std::stoi(ctx.args[++i]); continue; }
+                if (a == "-j" && i + 1 < ctx.args.size()) { opt.jobs = parse_jobs(ctx.args[++i]); continue; }
+                if (a == "-mtime" && i + 1 < ctx.args.size()) {
+                    std::string s = ctx.args[++i];
+                    if (!s.empty() && (s[0] == '+' || s[0] == '-')) { opt.mtime_mode = (s[0] == '+') ? +1 : -1; s = s.substr(1); }
+                    opt.mtime_days = std::stoll(s);
+                    continue;
+                }
+                if (a == "-newer" && i + 1 < ctx.args.size()) {
+                    const std::string& ref = ctx.args[++i];
+                    walk::Type type;
+                    std::uint64_t size;
+                    std::string host;
+                    try { host = ctx.vfs.resolveSecure(ctx.cwd, to_vfs_path(ref)).string(); }
+                    catch (const std::exception& e) { ctx.out << "find: " << e.what() << std::endl; return 1; }
+                    if (!walk::stat(host, type, size, opt.newer)) { ctx.out << "find: " << ref << ": no such file or directory" << std::endl; return 1; }
+                    continue;
+                }
+                if (a == "-delete") { opt.remove = true; continue; }
+                if (a == "-exec") {
+                    size_t end = i + 1;
+                    while (end < ctx.args.size() && ctx.args[end] != "+") ++end;
+                    // The command, its arguments, then {} right before the +
+                    if (end == ctx.args.size() || end < i + 3 || ctx.args[end - 1] != "{}") {
+                        ctx.out << "find: -exec needs CMD [ARGS...] {} +" << std::endl; return 2;
+                    }
+                    opt.exec.assign(ctx.args.begin() + static_cast<std::ptrdiff_t>(i + 1), ctx.args.begin() + static_cast<std::ptrdiff_t>(end - 1));
+                    i = end;
+                    continue;
+                }
+            } catch (const std::exception&) {
+                // malformed number: reported below
             }
-            if (a == "-maxdepth" && i + 1 < ctx.args.size()) { maxdepth = std::stoi(ctx.args[++i]); continue; }
             ctx.out << "find: unknown or malformed option: " << a << std::endl; return 2;
         }
 
+        const glob::Pattern name_glob(opt.name_pat);
+        ICommand* exec_cmd = nullptr;
+        if (!opt.exec.empty()) {
+            exec_cmd = ctx.registry ? ctx.registry->find(opt.exec[0]) : nullptr;
+            if (!exec_cmd) { ctx.out << opt.exec[0] << ": command not found" << std::endl; return 127; }
+        }
+        const bool print = !exec_cmd && !opt.remove;
+
         fs::path start_abs;
         try { start_abs = ctx.vfs.resolveSecure(ctx.cwd, start); }
         catch (const std::exception& e) { ctx.out << "find: " << e.what() << std::endl; return 1; }
 
-        auto print_vfs_path = [&](const fs::path& host) {
-            std::error_code ec;
-            auto rel = fs::relative(host, ctx.vfs.root(), ec);
-            fs::path v = fs::path("/") / rel;
-            ctx.out << v.generic_string() << '\n';
+        // Entries are printed as the start's VFS path followed by the rest
+        // of their host path
+        std::string host_root = start_abs.generic_string();
+        while (host_root.size() > 1 && host_root.back() == '/') host_root.pop_back();
+        std::error_code ec;
+        std::string vfs_root = (fs::path("/") / fs::relative(start_abs, ctx.vfs.root(), ec)).lexically_normal().generic_string();
+        if (vfs_root.size() > 1 && vfs_root.back() == '/') vfs_root.pop_back();
+        auto append_display = [&](std::string& out, std::string_view host) {
+            if (host.size() == host_root.size()) out += vfs_root;
+            else out.append(vfs_root == "/" ? "" : vfs_root).append(host.substr(host_root.size()));
         };
 
-        auto match_entry = [&](const fs::directory_entry& de) {
-            std::error_code ec;
-            bool isdir = de.is_directory(ec);
-            bool isfile = de.is_regular_file(ec);
-            if (type_filter == 'd' && !isdir) return false;
-            if (type_filter == 'f' && !isfile) return false;
-            if (!name_pat.empty() && !match_glob(de.path().filename().string(), name_pat)) return false;
-            if (size_filter != LLONG_MIN && isfile) {
-                auto sz = (long long)fs::file_size(de.path(), ec);
-                if (size_mode < 0 && !(sz < size_filter)) return false;
-                if (size_mode == 0 && !(sz == size_filter)) return false;
-                if (size_mode > 0 && !(sz > size_filter)) return false;
+        // Display path back to host path, without resolving a final symlink
+        auto host_of = [&](const std::string& display) {
+            return host_root + display.substr(vfs_root == "/" ? 0 : vfs_root.size());
+        };
+
+        const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        constexpr std::int64_t kDay = 86400LL * 1000000000;
+        auto match_entry = [&](const walk::Entry& e) {
+            if (opt.type_filter == 'd' && e.type != walk::Type::Dir) return false;
+            if (opt.type_filter == 'f' && e.type != walk::Type::File) return false;
+            if (opt.type_filter == 'l' && e.type != walk::Type::Symlink) return false;
+            if (!opt.name_pat.empty() && !name_glob.match(e.name)) return false;
+            if (opt.size_filter != LLONG_MIN && e.type == walk::Type::File) {
+                auto sz = static_cast<long long>(e.size);
+                if (opt.size_mode < 0 && !(sz < opt.size_filter)) return false;
+                if (opt.size_mode == 0 && !(sz == opt.size_filter)) return false;
+                if (opt.size_mode > 0 && !(sz > opt.size_filter)) return false;
+            }
+            if (opt.mtime_days != LLONG_MIN) {
+                const std::int64_t age = now - e.mtime;
+                const long long days = age >= 0 ? age / kDay : -((-age + kDay - 1) / kDay);
+                if (opt.mtime_mode < 0 && !(days < opt.mtime_days)) return false;
+                if (opt.mtime_mode == 0 && !(days == opt.mtime_days)) return false;
+                if (opt.mtime_mode > 0 && !(days > opt.mtime_days)) return false;
             }
+            if (opt.newer != INT64_MIN && !(e.mtime > opt.newer)) return false;
             return true;
         };
 
-        std::error_code ec;
-        fs::file_status st = fs::status(start_abs, ec);
-        if (ec) { ctx.out << "find: cannot access start path" << std::endl; return 1; }
+        // Per-worker output, padded so workers never share a cache line
+        struct alignas(64) Sink {
+            std::vector<std::string> paths; // sorted mode, -exec, -delete
+            std::string buf;                // --unordered
+        };
+        std::mutex ready_mu;
+        // Handed to this thread: --unordered output and -exec batches
+        std::vector<std::string> ready;
+        std::vector<std::vector<std::string>> ready_batches;
 
-        if (fs::is_regular_file(st)) {
-            if (Interrupt::check()) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
-            fs::directory_entry de(start_abs, ec);
-            if (!ec && match_entry(de)) print_vfs_path(start_abs);
+        walk::Options wopt;
+        wopt.threads = opt.jobs ? opt.jobs : std::max(1u, std::thread::hardware_concurrency());
+        wopt.max_depth = opt.maxdepth;
+        wopt.stat = opt.size_filter != LLONG_MIN || opt.mtime_days != LLONG_MIN || opt.newer != INT64_MIN;
+        std::vector<Sink> sinks(wopt.threads);
+
+        walk::Walker walker(wopt, [&](const walk::Entry& e, unsigned w) {
+            if (!match_entry(e)) return true;
+            Sink& s = sinks[w];
+            if (!print || !opt.unordered) {
+                s.paths.emplace_back();
+                append_display(s.paths.back(), e.path);
+                if (exec_cmd && s.paths.size() >= kExecBatch) {
+                    std::lock_guard<std::mutex> lock(ready_mu);
+                    ready_batches.push_back(std::move(s.paths));
+                    s.paths.clear();
+                }
+                return true;
+            }
+            append_display(s.buf, e.path);
+            s.buf += '\n';
+            if (s.buf.size() >= kOutputBatch) {
+                std::lock_guard<std::mutex> lock(ready_mu);
+                ready.push_back(std::move(s.buf));
+                s.buf.clear();
+            }
+            return true;
+        });
+
+        auto interrupted = [&] { walker.stop(); ctx.out << "\nCommand interrupted." << std::endl; return 130; };
+        auto print_ready = [&] {
+            std::vector<std::string> batches;
+            {
+                std::lock_guard<std::mutex> lock(ready_mu);
+                batches.swap(ready);
+            }
+            for (const auto& b : batches) ctx.out.write(b.data(), static_cast<std::streamsize>(b.size()));
+        };
+
+        int status = 0;
+        const auto by_tree = [](const std::string& a, const std::string& b) { return walk::tree_less(a, b); };
+        // With -delete, paths already passed to -exec wait here
+        std::vector<std::string> matched;
+        // Runs the -exec command on `paths`, in this thread, as the only
+        // writer to ctx.out. False if cancelled.
+        auto run_exec = [&](std::vector<std::string>& paths) {
+            std::sort(paths.begin(), paths.end(), by_tree);
+            std::vector<std::string> args = opt.exec;
+            args.insert(args.end(), paths.begin(), paths.end());
+            CommandContext sub(args, ctx.in, ctx.out, ctx.vfs, ctx.env, ctx.cwd, ctx.registry);
+            sub.cancel = ctx.cancel;
+            if (exec_cmd->execute(sub) != 0) status = 1;
+            if (opt.remove) std::move(paths.begin(), paths.end(), std::back_inserter(matched));
+            return !ctx.cancel.cancelled();
+        };
+        auto exec_ready = [&] {
+            std::vector<std::vector<std::string>> batches;
+            {
+                std::lock_guard<std::mutex> lock(ready_mu);
+                batches.swap(ready_batches);
+            }
+            for (auto& b : batches)
+                if (!run_exec(b)) return false;
+            return true;
+        };
+
+        try {
+            if (!walker.start(host_root)) { ctx.out << "find: cannot access start path" << std::endl; return 1; }
+        } catch (const std::system_error& e) { ctx.out << "find: " << e.what() << std::endl; return 1; }
+        while (!walker.wait_for(std::chrono::milliseconds(20))) {
+            if (ctx.cancel.cancelled()) return interrupted();
+            if (print && opt.unordered) print_ready();
+            if (exec_cmd && !exec_ready()) return interrupted();
+        }
+        // Directories were read on worker threads; count them for this command
+        IoStats::add_listed(walker.dirs_listed());
+        if (ctx.cancel.cancelled()) return interrupted();
+
+        if (print && opt.unordered) {
+            print_ready();
+            for (const auto& s : sinks) ctx.out.write(s.buf.data(), static_cast<std::streamsize>(s.buf.size()));
             return 0;
         }
 
-        // Include start directory itself when depth 0 and matches filters
-        if (fs::is_directory(st)) {
-            fs::directory_entry de(start_abs, ec);
-            if (!ec && match_entry(de)) print_vfs_path(start_abs);
-
-            fs::recursive_directory_iterator it(start_abs, fs::directory_options::skip_permission_denied, ec), end;
-            for (; it != end; ++it) {
-                if (Interrupt::check()) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
-                if ((int)it.depth() >= maxdepth) { it.disable_recursion_pending(); }
-                const auto& de2 = *it;
-                if (match_entry(de2)) print_vfs_path(de2.path());
+        std::vector<std::string> paths;
+        size_t total = 0;
+        for (const auto& s : sinks) total += s.paths.size();
+        paths.reserve(total);
+        for (auto& s : sinks) std::move(s.paths.begin(), s.paths.end(), std::back_inserter(paths));
+        std::sort(paths.begin(), paths.end(), by_tree);
+
+        if (exec_cmd) {
+            if (!exec_ready()) return interrupted();
+            // What the workers had not handed over yet
+            for (size_t at = 0; at < paths.size(); at += kExecBatch) {
+                std::vector<std::string> batch(std::make_move_iterator(paths.begin() + static_cast<std::ptrdiff_t>(at)),
+                                               std::make_move_iterator(paths.begin() + static_cast<std::ptrdiff_t>(std::min(paths.size(), at + kExecBatch))));
+                if (!run_exec(batch)) return interrupted();
             }
+            paths.clear();
+        }
+        if (opt.remove && exec_cmd) {
+            // Batches run in walk order; deletion needs the whole tree order
+            paths = std::move(matched);
+            std::sort(paths.begin(), paths.end(), by_tree);
+        }
+        if (opt.remove) {
+            // Reverse pre-order: every directory after its entries
+            for (auto it = paths.rbegin(); it != paths.rend(); ++it) {
+                if (ctx.cancel.cancelled()) return interrupted();
+                if (*it == vfs_root) continue; // the start path, sorted first
+                try { ctx.vfs.remove(host_of(*it), false); }
+                catch (const std::exception& e) { ctx.out << "find: cannot delete " << *it << ": " << e.what() << std::endl; status = 1; }
+            }
+            return status;
+        }
+        if (!print) return status;
+        for (const auto& p : paths) {
+            if (ctx.cancel.cancelled()) return interrupted();
+            ctx.out << p << '\n';
         }
         return 0;
     }
@@ -1,15 +1,384 @@
 #include "../shell/ICommand.hpp"
 #include "../shell/CommandContext.hpp"
 #include "../vfs/IVfs.hpp"
+#include "../core/IoStats.hpp"
 #include "Helpers.hpp"
-#include "../core/Interrupt.hpp"
+#include "../util/Ignore.hpp"
+#include "../util/Regex.hpp"
+#include "../util/Search.hpp"
+#include "../util/TrigramIndex.hpp"
 #include <algorithm>
-#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+// Hits are searched for in windows of this size so a multi-GB buffer
+// still polls for cancellation.
+static constexpr size_t kScanWindow = 4 << 20;
+static constexpr size_t kStdinChunk = 64 * 1024;
+// First read when a file may not need reading to the end; more than
+// search::looks_binary() looks at.
+static constexpr size_t kFirstChunk = 64 * 1024;
+// grep -r keeps at most this many files per worker queued or finished but
+// not yet printed, which bounds memory when one file holds up ordered output.
+static constexpr size_t kInFlightPerWorker = 4;
+
+namespace {
+
+struct GrepOptions {
+    bool line_numbers = false; // -n
+    bool ignore_case = false;  // -i
+    bool recursive = false;    // -r
+    bool extended = false;     // -E
+    bool unordered = false;    // --unordered
+    bool which = false;        // --which
+    bool list_files = false;   // -l
+    bool count = false;        // -c
+    bool quiet = false;        // -q
+    bool no_ignore = false;    // --no-ignore
+    size_t max_count = SIZE_MAX; // -m
+    unsigned jobs = 0;         // -j; 0 picks the hardware thread count
+};
+
+// The compiled patterns. Copies are independent, so every worker owns one
+// and the regex's DFA cache is never shared.
+class Matcher {
+public:
+    Matcher(std::vector<std::string> patterns, const GrepOptions& opt) : patterns_(std::move(patterns)) {
+        if (patterns_.empty()) return; // an empty -f file matches nothing
+        if (opt.extended) {
+            re_.emplace(patterns_, opt.ignore_case);
+            if (opt.which && patterns_.size() > 1)
+                for (const auto& p : patterns_) each_.emplace_back(p, opt.ignore_case);
+        } else if (patterns_.size() == 1) {
+            finder_.emplace(patterns_[0], opt.ignore_case);
+        } else {
+            multi_.emplace(patterns_, opt.ignore_case);
+        }
+    }
+
+    // Some position inside the first matching line at or after `from`,
+    // which is always a line start; npos if none.
+    size_t next_hit(std::string_view data, size_t from) const {
+        if (re_) return re_->find_line(data, from);
+        if (finder_) return finder_->find(data, from);
+        if (multi_) return multi_->find(data, from);
+        return std::string_view::npos;
+    }
+
+    // The pattern that matched in `line`: for fixed strings the first to
+    // complete a match, for -E the first listed one that matches.
+    const std::string& which(std::string_view line) const {
+        size_t i = 0;
+        if (multi_) multi_->find(line, 0, i);
+        for (size_t k = 0; k < each_.size(); ++k)
+            if (each_[k].match_line(line)) { i = k; break; }
+        return patterns_[i];
+    }
+
+    // Literals such that every matching line holds one of them, to narrow
+    // grep -r through a trigram index; nullopt if some pattern has none
+    // long enough.
+    std::optional<std::vector<std::string>> index_literals() const {
+        const auto& literals = re_ ? re_->required_literals() : patterns_;
+        if (literals.empty()) return std::nullopt;
+        for (const auto& l : literals)
+            if (l.size() < trigram::kMinLiteral) return std::nullopt;
+        return literals;
+    }
+
+private:
+    std::vector<std::string> patterns_;
+    std::optional<search::Finder> finder_;     // one fixed string
+    std::optional<search::MultiFinder> multi_; // several, in one pass
+    std::optional<regex::Regex> re_;           // -E: all patterns as one DFA
+    std::vector<regex::Regex> each_;           // -E --which: one per pattern
+};
+
+// Searches one input, which may arrive in pieces, writing the matching
+// lines to `out`, each prefixed with "label:" ("" for stdin), or what
+// -l / -c / -q ask for instead. Hits are found with a whole-buffer scan
+// and expanded to their lines, so text between matches is only looked at
+// by the vector scan. The answer can be known early: after -m lines, or
+// the first one for -l, -q and binary files.
+class Scan {
+public:
+    Scan(std::string_view label, const Matcher& m, const GrepOptions& opt, std::ostream& out)
+        : label_(label), m_(m), opt_(opt), out_(out) {}
+
+    // Searches the lines of `data` not searched yet. `data` is everything
+    // seen so far (earlier calls saw a prefix of it); unless `final`, a
+    // last line without '\n' waits for the next call. Returns false when
+    // cancelled.
+    bool feed(std::string_view data, bool final, const CancelToken& cancel) {
+        if (!started_) {
+            started_ = true;
+            binary_ = search::looks_binary(data);
+            print_lines_ = !binary_ && !opt_.list_files && !opt_.count && !opt_.quiet;
+            if (opt_.list_files || opt_.quiet || (binary_ && !opt_.count)) limit_ = std::min<size_t>(1, limit_);
+        }
+        if (!final) {
+            size_t nl = data.rfind('\n');
+            data = data.substr(0, nl == std::string_view::npos ? 0 : nl + 1);
+        }
+        while (pos_ < data.size() && !done()) {
+            if (cancel.cancelled()) return false;
+            // Bounded windows keep cancellation responsive on huge files; each
+            // one ends at a line boundary.
+            size_t window = std::min(data.size(), pos_ + kScanWindow);
+            size_t nl = data.find('\n', window);
+            window = nl == std::string_view::npos ? data.size() : nl + 1;
+            size_t hit = m_.next_hit(data.substr(0, window), pos_);
+            if (hit == std::string_view::npos) {
+                pos_ = window;
+                continue;
+            }
+            size_t start = hit == 0 ? std::string_view::npos : data.rfind('\n', hit - 1);
+            start = start == std::string_view::npos ? 0 : start + 1;
+            size_t end = data.find('\n', hit);
+            if (end == std::string_view::npos) end = data.size();
+            ++selected_;
+            pos_ = end + 1;
+            if (!print_lines_) continue;
+            if (!label_.empty()) out_ << label_ << ':';
+            if (opt_.line_numbers) {
+                line_no_ += search::count(data.substr(counted_, start - counted_), '\n');
+                counted_ = start;
+                out_ << line_no_ << ':';
+            }
+            if (opt_.which) out_ << m_.which(data.substr(start, end - start)) << ':';
+            out_.write(data.data() + start, static_cast<std::streamsize>(end - start));
+            out_ << '\n';
+        }
+        return true;
+    }
+
+    // True once the rest of the input cannot change the output.
+    bool done() const { return selected_ >= limit_; }
+    size_t selected() const { return selected_; }
+
+    // Prints what -l, -c and binary files print after the search.
+    void finish() {
+        const std::string_view name = label_.empty() ? std::string_view("(standard input)") : label_;
+        if (opt_.quiet) return;
+        if (opt_.list_files) {
+            if (selected_ > 0) out_ << name << '\n';
+        } else if (opt_.count) {
+            if (!label_.empty()) out_ << label_ << ':';
+            out_ << selected_ << '\n';
+        } else if (binary_ && selected_ > 0) {
+            out_ << "Binary file " << name << " matches\n";
+        }
+    }
+
+private:
+    std::string_view label_;
+    const Matcher& m_;
+    const GrepOptions& opt_;
+    std::ostream& out_;
+    bool started_ = false, binary_ = false, print_lines_ = false;
+    size_t limit_ = opt_.max_count;
+    size_t pos_ = 0, counted_ = 0, line_no_ = 1, selected_ = 0;
+};
+
+// Searches the file at `host` (see Scan) and adds its matching lines to
+// `selected`. When the answer can come early (-l, -q, -m) the file is
+// read in growing chunks and reading stops with the search; otherwise it
+// is read whole. Either way it is read through `vfs`. Returns false when cancelled; throws if the file cannot
+// be read.
+bool search_file(IVfs& vfs, const std::filesystem::path& host, std::string_view label, const Matcher& m,
+                 const GrepOptions& opt, const CancelToken& cancel, std::ostream& out, size_t& selected) {
+    Scan scan(label, m, opt, out);
+    if (!opt.list_files && !opt.quiet && opt.max_count == SIZE_MAX) {
+        std::string data = vfs.readFile(host);
+        if (!scan.feed(data, true, cancel)) return false;
+    } else {
+        std::string data;
+        for (size_t chunk = kFirstChunk;; chunk = std::min(chunk * 2, kScanWindow)) {
+            bool eof = vfs.readFileRange(host, data.size(), chunk, data) < chunk;
+            if (!scan.feed(data, eof, cancel)) return false;
+            if (eof || scan.done()) break;
+        }
+    }
+    scan.finish();
+    selected += scan.selected();
+    return true;
+}
+
+// Searches a whole buffer (see Scan), such as standard input.
+bool search_buffer(std::string_view data, std::string_view label, const Matcher& m,
+                   const GrepOptions& opt, const CancelToken& cancel, std::ostream& out, size_t& selected) {
+    Scan scan(label, m, opt, out);
+    if (!scan.feed(data, true, cancel)) return false;
+    scan.finish();
+    selected += scan.selected();
+    return true;
+}
+
+// grep -r on a pool of workers. The calling thread walks the tree, queues
+// files with add() and is the only one writing to ctx.out; workers read and
+// search files into per-file buffers. Output is in walk order unless
+// --unordered, where a file's lines are printed as soon as it is done.
+// Either way the lines of one file are never interleaved with another's.
+// With -q, add() and finish() return false once a match is in, and
+// files still queued are dropped.
+class ParallelSearch {
+public:
+    ParallelSearch(const Matcher& m, const GrepOptions& opt, CommandContext& ctx, unsigned workers)
+        : opt_(opt), ctx_(ctx), limit_(workers * kInFlightPerWorker) {
+        threads_.reserve(workers);
+        try {
+            for (unsigned i = 0; i < workers; ++i)
+                threads_.emplace_back([this, m, cancel = ctx.cancel] { work(m, cancel); });
+        } catch (...) {
+            // The destructor does not run for a half-built pool
+            close();
+            throw;
+        }
+    }
+
+    ~ParallelSearch() { close(); }
+
+    // Queues one file, printing whatever has finished meanwhile. Blocks
+    // while too many files are in flight. False when cancelled or, with
+    // -q, done.
+    bool add(std::filesystem::path host, std::string label) {
+        std::unique_lock<std::mutex> lock(mu_);
+        if (!wait_and_print(lock, limit_ - 1)) return false;
+        queue_.push_back({next_seq_++, std::move(host), std::move(label)});
+        lock.unlock();
+        work_cv_.notify_one();
+        return true;
+    }
+
+    // Waits for every queued file and prints the rest. False when
+    // cancelled or, with -q, done.
+    bool finish() {
+        std::unique_lock<std::mutex> lock(mu_);
+        return wait_and_print(lock, 0);
+    }
+
+    // Matching lines in the files printed so far.
+    size_t selected() const { return selected_; }
+    // True if one of those files could not be read.
+    bool failed() const { return failed_; }
+    // After add() or finish() returned false: true if that was -q having
+    // seen a match rather than a cancellation.
+    bool answered() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return opt_.quiet && found_;
+    }
+
+private:
+    // Stops the workers once the queue is empty and waits for them.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            closing_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto& t : threads_) t.join();
+        threads_.clear();
+    }
+
+    struct Job {
+        size_t seq;
+        std::filesystem::path host;
+        std::string label;
+    };
+    struct Result {
+        std::string text;
+        std::uint64_t bytes_read = 0;
+        size_t selected = 0;
+        bool failed = false; // the file could not be read
+    };
+
+    void work(Matcher m, CancelToken cancel) {
+        std::unique_lock<std::mutex> lock(mu_);
+        while (true) {
+            work_cv_.wait(lock, [this] { return closing_ || !queue_.empty(); });
+            // finish() has drained the queue unless this is a cancellation
+            // or -q has its answer
+            if (closing_ || (opt_.quiet && found_)) return;
+            Job job = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+
+            Result r;
+            std::ostringstream out;
+            bool ok = true;
+            auto before = IoStats::current();
+            try {
+                ok = search_file(ctx_.vfs, job.host, job.label, m, opt_, cancel, out, r.selected);
+            } catch (const std::exception& e) {
+                out << "grep: " << e.what() << '\n';
+                r.failed = true;
+            }
+            r.bytes_read = IoStats::current().bytes_read - before.bytes_read;
+            r.text = out.str();
+
+            lock.lock();
+            if (!ok) cancelled_ = true;
+            found_ = found_ || r.selected > 0;
+            done_.emplace(job.seq, std::move(r));
+            done_cv_.notify_all();
+        }
+    }
+
+    // Prints finished results until at most `max_in_flight` files remain
+    // queued or unprinted. Polls for cancellation while waiting.
+    bool wait_and_print(std::unique_lock<std::mutex>& lock, size_t max_in_flight) {
+        while (true) {
+            print_ready(lock);
+            if (opt_.quiet && found_) return false;
+            if (cancelled_ || ctx_.cancel.cancelled()) { cancelled_ = true; return false; }
+            if (next_seq_ - printed_ <= max_in_flight) return true;
+            done_cv_.wait_for(lock, std::chrono::milliseconds(20));
+        }
+    }
+
+    void print_ready(std::unique_lock<std::mutex>& lock) {
+        std::vector<Result> ready;
+        for (auto it = done_.begin(); it != done_.end() && (opt_.unordered || it->first == next_print_);) {
+            ready.push_back(std::move(it->second));
+            it = done_.erase(it);
+            ++next_print_;
+        }
+        if (ready.empty()) return;
+        // Workers keep going while this thread writes
+        lock.unlock();
+        for (const auto& r : ready) {
+            ctx_.out.write(r.text.data(), static_cast<std::streamsize>(r.text.size()));
+            // Reads happened on worker threads; count them for this command
+            IoStats::add_read(r.bytes_read);
+            selected_ += r.selected;
+            failed_ = failed_ || r.failed;
+        }
+        lock.lock();
+        printed_ += ready.size();
+    }
+
+    const GrepOptions& opt_;
+    CommandContext& ctx_;
+    const size_t limit_;
+
+    std::mutex mu_;
+    std::condition_variable work_cv_, done_cv_;
+    std::deque<Job> queue_;
+    std::map<size_t, Result> done_; // by walk sequence number
+    size_t next_seq_ = 0, next_print_ = 0, printed_ = 0, selected_ = 0;
+    bool closing_ = false, cancelled_ = false, found_ = false, failed_ = false;
+    std::vector<std::thread> threads_;
+};
 
-static std::string to_lower(std::string s){
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return (char)std::tolower(c); });
-    return s;
 }
 
 class Grep : public ICommand {
@@ -18,97 +387,232 @@ public:
     std::string help() const override {
         return R"(grep: print lines matching a pattern
 Synopsis:
-  grep [-n] [-i] [-r] PATTERN [path]
+  grep [-n] [-i] [-r] [-E] [-l|-c|-q] [-m N] [-j N] [--unordered]
+       [--which] [--no-ignore] PATTERN [path]
+  grep [options] -e PATTERN... | -f FILE [path]
 Options:
   -n   Prefix each line with line number
-  -i   Ignore case distinctions
+  -i   Ignore case distinctions (ASCII letters; other bytes match exactly)
   -r   Read all files under each directory, recursively
+  -E   PATTERN is an extended regular expression: . [...] * + ? {m,n}
+       | ( ) ^ $ and \w \s \d (uppercase to negate). Matched in linear
+       time; '.' and [^...] match single bytes.
+  -e PATTERN   Match PATTERN; repeat for several. A line matches if any
+               pattern does, and all are searched for in one pass
+  -f FILE      Read patterns from FILE, one per line (combines with -e)
+  --which      Print the pattern that matched before each line
+  -l   Print only the names of files with a match; each file is read
+       only up to its first match
+  -c   Print only the number of matching lines (per file with a path)
+  -q   Print nothing; stop at the first match anywhere
+  -m N Stop reading a file after N matching lines
+  --no-ignore  With -r, do not read .gitignore and .cortexignore files
+  -j N         With -r, search N files at a time (default: one per
+               hardware thread; -j 1 searches on the calling thread)
+  --unordered  With -r, print each file's matches as soon as it is
+               searched instead of in directory-walk order
 Notes:
-  Without a path, reads from standard input.
+  With -r, .gitignore and .cortexignore files in the searched directories
+  exclude paths as in git (*.log, build/, /out, a/**/b, !keep.log), and
+  excluded directories are not entered.
+  With -r under a directory indexed by 'index build', files that cannot
+  contain any pattern are skipped without being read (except with -c).
+  Without a path, reads from standard input. Without -E, PATTERN is a
+  fixed string. Short options combine, as in -ri.
+  A file with NUL bytes near its start is binary: a match is reported as
+  "Binary file PATH matches" instead of printing lines.
+  Exit status is 0 if some line matched, 1 if none did, and 2 if a
+  path could not be read, unless -q had already found a match.
 Examples:
   grep -n error app.log
   grep -ri todo /projects
+  grep -E 'timeout after [0-9]+ ms' app.log
+  grep -r -j 8 --unordered ERROR /logs
+  grep -r --which -f signatures.txt /logs
+  grep -rl TODO /projects
+  if grep -rq password /etc; then echo found; fi
 )";
     }
     int execute(CommandContext& ctx) override {
         if (ctx.args.size() == 1) {
-            ctx.out << "grep: common usage\n  grep [-n] [-i] [-r] PATTERN [path]\nUse 'help grep' for full help." << std::endl;
+            ctx.out << "grep: common usage\n  grep [-n] [-i] [-r] [-E] PATTERN [path]\nUse 'help grep' for full help." << std::endl;
             return 0;
         }
         using namespace std;
         namespace fs = std::filesystem;
-        bool opt_n=false, opt_i=false, opt_r=false;
-        string pattern;
+        GrepOptions opt;
+        vector<string> patterns; // from -e and -f, in order
+        bool have_patterns = false;
         vector<string> paths;
+        // Short options may be combined (-ri); anything else starting with
+        // '-' is taken as the pattern.
+        auto set_flags = [&](const string& a){
+            if (a.size() < 2 || a[0] != '-' || a.find_first_not_of("nirElcq", 1) != string::npos) return false;
+            for (char c : a.substr(1)) {
+                if (c=='n') opt.line_numbers=true;
+                else if (c=='i') opt.ignore_case=true;
+                else if (c=='r') opt.recursive=true;
+                else if (c=='l') opt.list_files=true;
+                else if (c=='c') opt.count=true;
+                else if (c=='q') opt.quiet=true;
+                else opt.extended=true;
+            }
+            return true;
+        };
+        // One pattern per line; a trailing newline does not add an empty one
+        auto read_patterns = [&](const string& file){
+            auto host = ctx.vfs.resolveSecure(ctx.cwd, to_vfs_path(file));
+            string data = ctx.vfs.readFile(host);
+            for (size_t pos = 0; pos < data.size();) {
+                size_t nl = data.find('\n', pos);
+                if (nl == string::npos) nl = data.size();
+                size_t len = nl - pos;
+                if (len > 0 && data[pos + len - 1] == '\r') --len;
+                patterns.push_back(data.substr(pos, len));
+                pos = nl + 1;
+            }
+        };
+        bool options_done = false;
         for (size_t i=1;i<ctx.args.size();++i){
             const auto& a=ctx.args[i];
-            if (a=="-n") { opt_n=true; continue; }
-            if (a=="-i") { opt_i=true; continue; }
-            if (a=="-r") { opt_r=true; continue; }
-            if (pattern.empty()) { pattern=a; continue; }
-            paths.push_back(a);
-        }
-        if (pattern.empty()) { ctx.out << "grep: missing PATTERN" << endl; return 2; }
-        string pat = opt_i ? to_lower(pattern) : pattern;
-
-        auto search_file = [&](const fs::path& host_path){
-            try{
-                string data = ctx.vfs.readFile(host_path);
-                // iterate lines
-                size_t pos=0; size_t line_no=1;
-                while (pos <= data.size()){
-                    if (Interrupt::check()) { ctx.out << "\nCommand interrupted." << endl; return; }
-                    size_t end = data.find('\n', pos);
-                    string line = end==string::npos ? data.substr(pos) : data.substr(pos, end-pos);
-                    string hay = opt_i ? to_lower(line) : line;
-                    if (hay.find(pat) != string::npos){
-                        std::error_code ec;
-                        auto rel = std::filesystem::relative(host_path, ctx.vfs.root(), ec);
-                        fs::path v = fs::path("/") / rel;
-                        ctx.out << v.generic_string();
-                        ctx.out << ':';
-                        if (opt_n) ctx.out << line_no << ':';
-                        ctx.out << line << '\n';
+            // Options may follow operands, as before; "--" ends them
+            if (!options_done) {
+                if (a=="--") { options_done = true; continue; }
+                if (a=="--unordered") { opt.unordered=true; continue; }
+                if (a=="--which") { opt.which=true; continue; }
+                if (a=="--no-ignore") { opt.no_ignore=true; continue; }
+                if (a=="-j" || a=="-m" || a=="-e" || a=="-f"){
+                    if (i+1>=ctx.args.size()) { ctx.out << "grep: " << a << " needs an argument" << endl; return 2; }
+                    const string& v = ctx.args[++i];
+                    have_patterns = have_patterns || a == "-e" || a == "-f";
+                    if (a=="-e") { patterns.push_back(v); continue; }
+                    if (a=="-f") {
+                        try { read_patterns(v); }
+                        catch(const std::exception& e) { ctx.out << "grep: " << v << ": " << e.what() << endl; return 2; }
+                        continue;
+                    }
+                    try {
+                        if (a=="-j") opt.jobs = parse_jobs(v);
+                        else opt.max_count = std::stoul(v);
                     }
-                    if (end==string::npos) break; else { pos = end+1; ++line_no; }
+                    catch(const std::exception&) { ctx.out << "grep: invalid " << a << " count: " << v << endl; return 2; }
+                    continue;
                 }
-            }catch(const std::exception& e){ ctx.out << "grep: " << e.what() << endl; }
+                if (set_flags(a)) continue;
+            }
+            // Without -e/-f the first operand is the pattern
+            if (!have_patterns) { patterns.push_back(a); have_patterns = true; continue; }
+            paths.push_back(a);
+        }
+        if (!have_patterns) { ctx.out << "grep: missing PATTERN" << endl; return 2; }
+        std::optional<Matcher> matcher;
+        try { matcher.emplace(std::move(patterns), opt); }
+        catch (const std::exception& e) { ctx.out << "grep: " << e.what() << endl; return 2; }
+        const Matcher& m = *matcher;
+        auto interrupted = [&]{ ctx.out << "\nCommand interrupted." << endl; return 130; };
+
+        // VFS path for display: one fs::relative per argument; files found
+        // under a directory extend it lexically.
+        auto display_of = [&](const fs::path& host) {
+            std::error_code ec;
+            auto rel = fs::relative(host, ctx.vfs.root(), ec);
+            return (fs::path("/") / rel).lexically_normal().generic_string();
+        };
+        size_t selected = 0; // matching lines, outside the pool
+        bool failed = false; // some path could not be read, outside the pool
+        auto search_one = [&](const fs::path& host_path, const string& label){
+            try{ return search_file(ctx.vfs, host_path, label, m, opt, ctx.cancel, ctx.out, selected); }
+            catch(const std::exception& e){ ctx.out << "grep: " << e.what() << endl; failed = true; }
+            return true;
         };
 
         if (paths.empty()){
             // read from stdin
-            string all, line; vector<string> lines; lines.reserve(128);
-            while (std::getline(ctx.in, line)) { if (Interrupt::check()) { ctx.out << "\nCommand interrupted." << endl; return 130; } lines.push_back(line); }
-            for (size_t i=0;i<lines.size();++i){
-                if (Interrupt::check()) { ctx.out << "\nCommand interrupted." << endl; return 130; }
-                string hay = opt_i ? to_lower(lines[i]) : lines[i];
-                if (hay.find(pat) != string::npos){
-                    if (opt_n) ctx.out << (i+1) << ':';
-                    ctx.out << lines[i] << '\n';
-                }
+            string data;
+            char buf[kStdinChunk];
+            while (ctx.in.read(buf, sizeof(buf)) || ctx.in.gcount() > 0) {
+                if (ctx.cancel.cancelled()) return interrupted();
+                data.append(buf, static_cast<size_t>(ctx.in.gcount()));
             }
-            return 0;
+            if (!search_buffer(data, "", m, opt, ctx.cancel, ctx.out, selected)) return interrupted();
+            return selected > 0 ? 0 : 1;
         }
 
+        unsigned workers = opt.jobs ? opt.jobs : std::max(1u, std::thread::hardware_concurrency());
+        std::optional<ParallelSearch> pool;
+        // The pool stopped early: -q has its answer, or Ctrl-C
+        auto stopped = [&]{ return pool->answered() ? 0 : interrupted(); };
         for (auto& pstr : paths){
             fs::path vfs_p = to_vfs_path(pstr);
             fs::path host;
             try { host = ctx.vfs.resolveSecure(ctx.cwd, vfs_p); }
-            catch(const std::exception& e){ ctx.out << "grep: " << e.what() << endl; continue; }
+            catch(const std::exception& e){ ctx.out << "grep: " << e.what() << endl; failed = true; continue; }
 
             std::error_code ec;
             if (fs::is_directory(host, ec)){
-                if (!opt_r){ ctx.out << "grep: " << pstr << ": Is a directory (use -r)" << endl; continue; }
+                if (!opt.recursive){ ctx.out << "grep: " << pstr << ": Is a directory (use -r)" << endl; failed = true; continue; }
+                if (workers > 1 && !pool) {
+                    // No threads to be had: search on this one
+                    try { pool.emplace(m, opt, ctx, workers); }
+                    catch (const std::system_error&) { workers = 1; }
+                }
+                string base = display_of(host);
+                // Files the index rules out are not read at all. -c prints
+                // a line for every file, 0 included, so it reads them all.
+                std::optional<trigram::Index> index;
+                if (auto literals = opt.count ? std::nullopt : m.index_literals()) {
+                    try {
+                        index = trigram::Index::covering(ctx.vfs, base);
+                        if (index) index->narrow(*literals);
+                    } catch (const std::exception&) { index.reset(); }
+                }
+                if (base.size() > 1) base += '/';
+                const size_t index_prefix = index ? (index->root() == "/" ? 1 : index->root().size() + 1) : 0;
+                const size_t host_len = host.native().size() + 1;
+                // Ignore rules are applied as the walk goes, so an excluded
+                // directory is never listed
+                ignore::Stack ignores;
+                if (!opt.no_ignore) ignores.push(ctx.vfs, host, 0);
                 for (fs::recursive_directory_iterator it(host, fs::directory_options::skip_permission_denied, ec), end; it!=end; ++it){
-                    if (it->is_regular_file(ec)) search_file(it->path());
+                    if (ctx.cancel.cancelled()) return interrupted();
+                    string rel = fs::path(it->path().native().substr(host_len)).generic_string();
+                    if (!opt.no_ignore) {
+                        ignores.pop_to(static_cast<size_t>(it.depth()) + 1);
+                        bool is_dir = it->is_directory(ec);
+                        if (ignores.ignored(rel, is_dir)) {
+                            if (is_dir) it.disable_recursion_pending();
+                            continue;
+                        }
+                        if (is_dir) {
+                            if (!it->is_symlink(ec)) ignores.push(ctx.vfs, it->path(), rel.size() + 1);
+                            continue;
+                        }
+                    }
+                    if (!it->is_regular_file(ec)) continue;
+                    string label = base + rel;
+                    if (index && index->excludes(std::string_view(label).substr(index_prefix), it->path())) continue;
+                    if (pool) {
+                        if (!pool->add(it->path(), std::move(label))) return stopped();
+                        continue;
+                    }
+                    if (!search_one(it->path(), label)) return interrupted();
+                    if (opt.quiet && selected > 0) return 0;
                 }
             } else if (fs::is_regular_file(host, ec)){
-                search_file(host);
+                // Keeps output in argument order behind earlier directories
+                if (pool && !pool->finish()) return stopped();
+                if (!search_one(host, display_of(host))) return interrupted();
+                if (opt.quiet && selected > 0) return 0;
             } else {
+                if (pool && !pool->finish()) return stopped();
                 ctx.out << "grep: cannot access: " << pstr << endl;
+                failed = true;
             }
         }
-        return 0;
+        if (pool && !pool->finish()) return stopped();
+        // -q has returned already if it found a match
+        if (failed || (pool && pool->failed())) return 2;
+        return selected + (pool ? pool->selected() : 0) > 0 ? 0 : 1;
     }
 };
 
@@ -2,8 +2,6 @@
 #include "../shell/CommandContext.hpp"
 #include "../shell/CommandRegistry.hpp"
 
-extern CommandRegistry* g_registry_for_help;
-
 class Help : public ICommand {
 public:
     std::string name() const override { return "help"; }
@@ -22,13 +20,13 @@ Examples:
     int execute(CommandContext& ctx) override {
         if (ctx.args.size() == 1) {
             ctx.out << "Commands:" << std::endl;
-            if (!g_registry_for_help) return 0;
-            for (auto& n : g_registry_for_help->list()) ctx.out << "  " << n << std::endl;
+            if (!ctx.registry) return 0;
+            for (auto& n : ctx.registry->list()) ctx.out << "  " << n << std::endl;
             ctx.out << "Use 'help <cmd>' for details." << std::endl;
             return 0;
         }
-        if (!g_registry_for_help) return 0;
-        auto* cmd = g_registry_for_help->find(ctx.args[1]);
+        if (!ctx.registry) return 0;
+        auto* cmd = ctx.registry->find(ctx.args[1]);
         if (!cmd) { ctx.out << "help: unknown command: " << ctx.args[1] << std::endl; return 1; }
         ctx.out << cmd->help() << std::endl;
         return 0;
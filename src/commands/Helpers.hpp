@@ -1,6 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <string>
 #include <filesystem>
+#include <stdexcept>
+#include <thread>
 
 inline std::filesystem::path to_vfs_path(const std::string& s) {
     std::filesystem::path p{s};
@@ -8,3 +11,16 @@ inline std::filesystem::path to_vfs_path(const std::string& s) {
     return p;
 }
 
+
+// -j is capped at this many workers per hardware thread; past that they
+// only contend for the disk and, for grep, the output lock.
+inline constexpr unsigned kMaxJobsPerThread = 4;
+
+// Parses a -j count, capped at kMaxJobsPerThread per hardware thread.
+// Throws std::invalid_argument (or std::out_of_range) unless it is >= 1.
+inline unsigned parse_jobs(const std::string& s) {
+    long long n = std::stoll(s);
+    if (n < 1) throw std::invalid_argument(s);
+    const unsigned cap = kMaxJobsPerThread * std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::min<long long>(n, cap));
+}
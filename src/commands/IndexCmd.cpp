@@ -0,0 +1,75 @@
+#include "../shell/ICommand.hpp"
+#include "../shell/CommandContext.hpp"
+#include "../vfs/IVfs.hpp"
+#include "Helpers.hpp"
+#include "../util/TrigramIndex.hpp"
+#include <filesystem>
+#include <iomanip>
+
+namespace fs = std::filesystem;
+
+class IndexCmd : public ICommand {
+public:
+    std::string name() const override { return "index"; }
+    std::string help() const override {
+        return R"(index: maintain a content index that speeds up grep -r
+Synopsis:
+  index build <path>
+  index update <path>
+  index drop <path>
+Notes:
+  build reads every file under the directory and records which trigrams
+  (3-byte sequences, ignoring ASCII case) each one contains. update does
+  the same but only reads files whose mtime or size changed since the
+  last build or update. drop deletes the index.
+  grep -r under an indexed directory skips files the index rules out for
+  every pattern of 3 or more bytes (for -E, a literal each match must
+  contain). Files changed since indexing are always searched, so output
+  is the same with or without an index; only the time differs.
+  Indexes are stored in /var/lib/index.
+Examples:
+  index build /logs
+  grep -r 'request id=7f3a' /logs
+  index update /logs
+)";
+    }
+    int execute(CommandContext& ctx) override {
+        if (ctx.args.size() != 3) {
+            ctx.out << "index: usage: index build|update|drop <path>" << std::endl;
+            return 2;
+        }
+        const std::string& sub = ctx.args[1];
+        if (sub != "build" && sub != "update" && sub != "drop") {
+            ctx.out << "index: unknown subcommand '" << sub << "'" << std::endl;
+            return 2;
+        }
+        std::string dir;
+        try {
+            auto host = ctx.vfs.resolveSecure(ctx.cwd, to_vfs_path(ctx.args[2]));
+            std::error_code ec;
+            if (!fs::is_directory(host, ec)) { ctx.out << "index: " << ctx.args[2] << ": not a directory" << std::endl; return 1; }
+            dir = (fs::path("/") / fs::relative(host, ctx.vfs.root(), ec)).lexically_normal().generic_string();
+        } catch (const std::exception& e) {
+            ctx.out << "index: " << e.what() << std::endl;
+            return 1;
+        }
+
+        try {
+            if (sub == "drop") {
+                if (!trigram::drop(ctx.vfs, dir)) { ctx.out << "index: " << dir << " is not indexed" << std::endl; return 1; }
+                return 0;
+            }
+            auto stats = trigram::build(ctx.vfs, dir, sub == "update", ctx.cancel);
+            if (!stats) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
+            ctx.out << "index: " << dir << ": " << stats->files << " files (" << stats->reused << " unchanged, "
+                    << std::fixed << std::setprecision(1) << static_cast<double>(stats->bytes) / (1 << 20)
+                    << " MB read), " << stats->trigrams << " trigrams" << std::endl;
+        } catch (const std::exception& e) {
+            ctx.out << "index: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+};
+
+namespace Builtins { std::unique_ptr<ICommand> make_index(){ return std::make_unique<IndexCmd>(); } }
@@ -0,0 +1,74 @@
+#include "../shell/ICommand.hpp"
+#include "../shell/CommandContext.hpp"
+#include "../vfs/IVfs.hpp"
+#include "../util/LocateDb.hpp"
+#include <filesystem>
+
+class Locate : public ICommand {
+public:
+    std::string name() const override { return "locate"; }
+    std::string help() const override {
+        return R"(locate: find files by name in the updatedb database
+Synopsis:
+  locate [-i] [-b] [-c] [-l N] PATTERN...
+Options:
+  -i      Ignore ASCII case
+  -b      Match the last path component only
+  -c      Print the number of matching paths instead of the paths
+  -l N    Stop after N paths
+Notes:
+  A PATTERN without wildcards matches anywhere in the path; with *, ? or
+  [...] it must match the whole path (or name, with -b), and * also
+  matches '/'. Paths matching any PATTERN are printed in tree order:
+  each directory comes right before its contents, and names are compared
+  byte by byte ("a", "a/b", "a-b").
+  Results are as of the last updatedb run: paths created since are
+  missing and deleted ones still listed. Exits with 1 if nothing matched.
+Examples:
+  locate report.txt
+  locate -b '*.log'
+  locate -i -c readme
+)";
+    }
+    int execute(CommandContext& ctx) override {
+        locate::Query q;
+        bool count = false;
+        std::uint64_t limit = UINT64_MAX;
+        for (size_t i = 1; i < ctx.args.size(); ++i) {
+            const auto& a = ctx.args[i];
+            if (a == "-i") { q.ignore_case = true; continue; }
+            if (a == "-b") { q.basename = true; continue; }
+            if (a == "-c") { count = true; continue; }
+            if (a == "-l") {
+                if (i + 1 >= ctx.args.size()) { ctx.out << "locate: -l needs an argument" << std::endl; return 2; }
+                try { limit = std::stoull(ctx.args[++i]); }
+                catch (const std::exception&) { ctx.out << "locate: invalid -l count: " << ctx.args[i] << std::endl; return 2; }
+                continue;
+            }
+            q.patterns.push_back(a);
+        }
+        if (q.patterns.empty()) { ctx.out << "locate: missing PATTERN" << std::endl; return 2; }
+
+        std::uint64_t found = 0;
+        try {
+            std::filesystem::path host = ctx.vfs.resolveSecure("/", locate::kDbPath);
+            std::error_code ec;
+            if (!std::filesystem::exists(host, ec)) { ctx.out << "locate: no database; run updatedb first" << std::endl; return 1; }
+            locate::Database db(host);
+            bool ok = db.search(q, ctx.cancel, [&](std::string_view path) {
+                if (found >= limit) return false;
+                ++found;
+                if (!count) ctx.out << path << '\n';
+                return true;
+            });
+            if (!ok) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
+        } catch (const std::exception& e) {
+            ctx.out << "locate: " << e.what() << std::endl;
+            return 1;
+        }
+        if (count) ctx.out << found << '\n';
+        return found ? 0 : 1;
+    }
+};
+
+namespace Builtins { std::unique_ptr<ICommand> make_locate(){ return std::make_unique<Locate>(); } }
@@ -2,6 +2,7 @@
 #include "../shell/CommandContext.hpp"
 #include "../vfs/IVfs.hpp"
 #include "Helpers.hpp"
+#include "../core/IoStats.hpp"
 #include <filesystem>
 #include <fstream>
 #include <system_error>
@@ -102,14 +103,25 @@ Examples:
             ++entries_emitted;
         };
 
+        auto interrupted = [&]{
+            if (!ctx.cancel.cancelled()) return false;
+            ctx.out << "\nCommand interrupted." << std::endl;
+            ofs.close();
+            std::error_code remove_ec;
+            fs::remove(out_host, remove_ec);
+            return true;
+        };
+
         try {
             for (const auto& entry : resolved){
                 std::error_code ec;
+                if (interrupted()) return 130;
                 if (entry.is_dir){
                     fs::path base = entry.host.parent_path();
                     add_dir_entry(base, entry.host);
                     fs::recursive_directory_iterator it(entry.host, fs::directory_options::skip_permission_denied, ec), end;
                     for (; it != end; ++it){
+                        if (interrupted()) return 130;
                         if (it->is_directory(ec)) add_dir_entry(base, it->path());
                         else if (it->is_regular_file(ec)) add_file(base, it->path());
                     }
@@ -131,6 +143,10 @@ Examples:
             return 1;
         }
 
+        // The archive is written directly, not through IVfs::writeFile
+        auto archive_bytes = ofs.tellp();
+        if (archive_bytes > 0) IoStats::add_written(static_cast<std::uint64_t>(archive_bytes));
+
         if (entries_emitted == 0) {
             ctx.out << "pack: no entries archived" << std::endl;
             std::error_code remove_ec;
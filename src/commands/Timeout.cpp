@@ -0,0 +1,56 @@
+#include "../shell/ICommand.hpp"
+#include "../shell/CommandContext.hpp"
+#include "../shell/CommandRegistry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Longer limits are cut to this; it keeps now() + limit well inside the
+// clock's range, where a larger double would overflow the conversion.
+static constexpr double kMaxSeconds = 365.0 * 24 * 60 * 60;
+
+class Timeout : public ICommand {
+public:
+    std::string name() const override { return "timeout"; }
+    std::string help() const override {
+        return R"(timeout: run a command with a time limit
+Synopsis:
+  timeout <secs> <command> [args...]
+Notes:
+  <secs> may be fractional. When the limit is reached the command is
+  cancelled at its next check point and timeout exits with status 124;
+  otherwise the command's own status is returned.
+Examples:
+  timeout 5 grep -r error /logs
+  timeout 0.5 find / -name "*.txt"
+)";
+    }
+    int execute(CommandContext& ctx) override {
+        if (ctx.args.size() < 3) { ctx.out << "timeout: usage: timeout <secs> <command> [args...]" << std::endl; return 2; }
+        double secs = 0;
+        try {
+            size_t used = 0;
+            secs = std::stod(ctx.args[1], &used);
+            if (used != ctx.args[1].size() || !std::isfinite(secs) || secs < 0) throw std::invalid_argument("secs");
+            secs = std::min(secs, kMaxSeconds);
+        } catch (const std::exception&) {
+            ctx.out << "timeout: invalid duration: " << ctx.args[1] << std::endl; return 2;
+        }
+        auto* cmd = ctx.registry ? ctx.registry->find(ctx.args[2]) : nullptr;
+        if (!cmd) { ctx.out << ctx.args[2] << ": command not found" << std::endl; return 127; }
+
+        std::vector<std::string> args(ctx.args.begin() + 2, ctx.args.end());
+        CommandContext sub(args, ctx.in, ctx.out, ctx.vfs, ctx.env, ctx.cwd, ctx.registry);
+        auto limit = std::chrono::duration_cast<CancelToken::Clock::duration>(std::chrono::duration<double>(secs));
+        sub.cancel = ctx.cancel.with_deadline(CancelToken::Clock::now() + limit);
+        int rc = cmd->execute(sub);
+        // The command may have seen the deadline only on worker threads'
+        // copies of the token, so ask the clock rather than sub.cancel
+        if (sub.cancel.expired() || sub.cancel.deadline_passed()) return 124;
+        return rc;
+    }
+};
+
+namespace Builtins { std::unique_ptr<ICommand> make_timeout(){ return std::make_unique<Timeout>(); } }
@@ -2,6 +2,7 @@
 #include "../shell/CommandContext.hpp"
 #include "../vfs/IVfs.hpp"
 #include "Helpers.hpp"
+#include "../core/IoStats.hpp"
 #include <filesystem>
 #include <fstream>
 
@@ -63,6 +64,7 @@ Examples:
 
         size_t entries = 0;
         while (true) {
+            if (ctx.cancel.cancelled()) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
             if (!read_line(ifs, line)) break; // EOF ok
             if (line.empty()) continue;
             if (line[0] == 'D') {
@@ -90,6 +92,10 @@ Examples:
                 ctx.out << "unpack: unknown entry" << std::endl; return 1;
             }
         }
+        // The archive is read directly, not through IVfs::readFile
+        std::error_code size_ec;
+        auto archive_bytes = fs::file_size(archive_host, size_ec);
+        if (!size_ec) IoStats::add_read(archive_bytes);
         if (entries == 0) {
             ctx.out << "unpack: archive contained no entries" << std::endl;
             return 1;
@@ -0,0 +1,48 @@
+#include "../shell/ICommand.hpp"
+#include "../shell/CommandContext.hpp"
+#include "../vfs/IVfs.hpp"
+#include "../util/LocateDb.hpp"
+#include <iomanip>
+
+class UpdateDb : public ICommand {
+public:
+    std::string name() const override { return "updatedb"; }
+    std::string help() const override {
+        return R"(updatedb: update the file name database used by locate
+Synopsis:
+  updatedb [--full]
+Options:
+  --full   Read every directory instead of reusing unchanged ones
+Notes:
+  Records every path in the VFS in /var/lib/locate.db. A directory whose
+  mtime is the same as at the last run keeps its recorded entries without
+  being read (its subdirectories are still checked), so a run after small
+  changes costs about one stat per directory. Symlinks are recorded, not
+  followed.
+Examples:
+  updatedb
+  locate report.txt
+)";
+    }
+    int execute(CommandContext& ctx) override {
+        bool full = false;
+        for (size_t i = 1; i < ctx.args.size(); ++i) {
+            if (ctx.args[i] == "--full") { full = true; continue; }
+            ctx.out << "updatedb: unknown option: " << ctx.args[i] << std::endl;
+            return 2;
+        }
+        try {
+            auto stats = locate::build(ctx.vfs, !full, ctx.cancel);
+            if (!stats) { ctx.out << "\nCommand interrupted." << std::endl; return 130; }
+            ctx.out << "updatedb: " << stats->entries << " paths, " << stats->dirs << " directories ("
+                    << stats->dirs_read << " read), " << std::fixed << std::setprecision(1)
+                    << static_cast<double>(stats->bytes) / 1024 << " KB" << std::endl;
+        } catch (const std::exception& e) {
+            ctx.out << "updatedb: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+};
+
+namespace Builtins { std::unique_ptr<ICommand> make_updatedb(){ return std::make_unique<UpdateDb>(); } }
@@ -0,0 +1,43 @@
+#include "AllocStats.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Global operator new/delete replacements that keep per-thread counters.
+// Counters are thread_local so concurrent sessions never contend on them.
+namespace {
+    thread_local std::uint64_t t_count = 0;
+    thread_local std::uint64_t t_bytes = 0;
+
+    // As the standard operator new does: on failure, call the installed
+    // new_handler and retry, throwing std::bad_alloc once there is none.
+    void* counted_alloc(std::size_t n) {
+        ++t_count;
+        t_bytes += n;
+        if (n == 0) n = 1;
+        while (true) {
+            if (void* p = std::malloc(n)) return p;
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void* counted_alloc_nothrow(std::size_t n) noexcept {
+        try { return counted_alloc(n); }
+        catch (...) { return nullptr; }
+    }
+}
+
+namespace AllocStats {
+    Snapshot current() { return Snapshot{t_count, t_bytes}; }
+}
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return counted_alloc_nothrow(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return counted_alloc_nothrow(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+
+namespace AllocStats {
+    struct Snapshot {
+        std::uint64_t count = 0; // number of operator new calls
+        std::uint64_t bytes = 0; // bytes requested from operator new
+    };
+    // Heap allocations made by the calling thread so far. Take two snapshots
+    // and subtract to measure a region of code.
+    Snapshot current();
+}
@@ -0,0 +1,18 @@
+#include "CancelToken.hpp"
+
+CancelToken CancelToken::with_deadline(Clock::time_point when) const {
+    CancelToken t;
+    t.flag_ = flag_;
+    t.deadline_ = (has_deadline_ && deadline_ < when) ? deadline_ : when;
+    t.has_deadline_ = true;
+    t.expired_ = expired_;
+    return t;
+}
+
+bool CancelToken::cancelled() const {
+    if (flag_ && flag_->load(std::memory_order_relaxed)) return true;
+    if (!has_deadline_) return false;
+    if (expired_) return true;
+    if (polls_++ % kClockStride == 0 && Clock::now() >= deadline_) expired_ = true;
+    return expired_;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <chrono>
+
+#include "Interrupt.hpp"
+
+// Cancellation state handed to a command through CommandContext. A token
+// is cancelled when its session's interrupt flag is set or its deadline has
+// passed. Tokens are small values: copy one per worker thread rather than
+// polling a shared instance.
+class CancelToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancelToken() = default;
+    explicit CancelToken(const Interrupt::Flag* flag) : flag_(flag) {}
+
+    // Copy of this token that also expires at `when` (the earlier deadline wins).
+    CancelToken with_deadline(Clock::time_point when) const;
+
+    // Cheap enough for per-line / per-entry polling: reads the interrupt
+    // flag every call but the clock only every kClockStride calls.
+    bool cancelled() const;
+    // True once a cancelled() call has observed the deadline passing.
+    // Only this copy's calls count; a worker's copy expires on its own.
+    bool expired() const { return expired_; }
+    // True if the deadline has passed, asking the clock.
+    bool deadline_passed() const { return has_deadline_ && Clock::now() >= deadline_; }
+    bool has_deadline() const { return has_deadline_; }
+
+private:
+    static constexpr unsigned kClockStride = 64;
+
+    const Interrupt::Flag* flag_ = nullptr;
+    Clock::time_point deadline_{};
+    bool has_deadline_ = false;
+    mutable bool expired_ = false;
+    mutable unsigned polls_ = 0;
+};
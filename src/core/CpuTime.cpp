@@ -0,0 +1,50 @@
+#include "CpuTime.hpp"
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/resource.h>
+#  include <sys/time.h>
+#endif
+
+namespace CpuTime {
+
+#ifdef _WIN32
+static long long filetime_us(const FILETIME& ft) {
+    ULARGE_INTEGER v;
+    v.LowPart = ft.dwLowDateTime;
+    v.HighPart = ft.dwHighDateTime;
+    return static_cast<long long>(v.QuadPart / 10); // 100 ns units
+}
+
+Times thread_times() {
+    FILETIME creation, exit, kernel, user;
+    Times t;
+    if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        t.user_us = filetime_us(user);
+        t.sys_us = filetime_us(kernel);
+    }
+    return t;
+}
+#else
+static long long timeval_us(const timeval& tv) {
+    return static_cast<long long>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+Times thread_times() {
+    rusage ru{};
+#ifdef RUSAGE_THREAD
+    int who = RUSAGE_THREAD;
+#else
+    int who = RUSAGE_SELF;
+#endif
+    Times t;
+    if (getrusage(who, &ru) == 0) {
+        t.user_us = timeval_us(ru.ru_utime);
+        t.sys_us = timeval_us(ru.ru_stime);
+    }
+    return t;
+}
+#endif
+
+}
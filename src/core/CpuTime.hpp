@@ -0,0 +1,11 @@
+#pragma once
+
+namespace CpuTime {
+    struct Times {
+        long long user_us = 0;
+        long long sys_us = 0;
+    };
+    // CPU time consumed by the calling thread (the whole process where the
+    // platform has no per-thread accounting).
+    Times thread_times();
+}
@@ -1,12 +1,18 @@
 #include "Interrupt.hpp"
 
 namespace {
-    std::atomic<bool> g_interrupted{false};
+    // Used by threads that have not bound a session flag.
+    Interrupt::Flag g_interrupted{false};
+    thread_local Interrupt::Flag* t_flag = nullptr;
+
+    Interrupt::Flag& current() { return t_flag ? *t_flag : g_interrupted; }
 }
 
 namespace Interrupt {
-    bool check() { return g_interrupted.load(std::memory_order_relaxed); }
-    void set() { g_interrupted.store(true, std::memory_order_relaxed); }
-    void clear() { g_interrupted.store(false, std::memory_order_relaxed); }
-}
+    Scope::Scope(Flag& flag) : prev_(t_flag) { t_flag = &flag; }
+    Scope::~Scope() { t_flag = prev_; }
 
+    bool check() { return current().load(std::memory_order_relaxed); }
+    void set() { current().store(true, std::memory_order_relaxed); }
+    void clear() { current().store(false, std::memory_order_relaxed); }
+}
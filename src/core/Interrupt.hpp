@@ -2,6 +2,22 @@
 #include <atomic>
 
 namespace Interrupt {
+    // Interrupt flag of one session. Each Shell owns one; the interactive
+    // shell's SIGINT handler sets it.
+    using Flag = std::atomic<bool>;
+
+    // Bind `flag` to the calling thread for the lifetime of the scope, so
+    // check()/set()/clear() act on that session only. Scopes nest.
+    class Scope {
+    public:
+        explicit Scope(Flag& flag);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        Flag* prev_;
+    };
+
     // Returns true if an interrupt (e.g., Ctrl+C) was requested
     bool check();
     // Set interrupt flag (signal-safe usage expected from handlers)
@@ -9,4 +25,3 @@ namespace Interrupt {
     // Clear interrupt flag
     void clear();
 }
-
@@ -0,0 +1,14 @@
+#include "IoStats.hpp"
+
+namespace {
+    thread_local std::uint64_t t_read = 0;
+    thread_local std::uint64_t t_written = 0;
+    thread_local std::uint64_t t_listed = 0;
+}
+
+namespace IoStats {
+    Snapshot current() { return Snapshot{t_read, t_written, t_listed}; }
+    void add_read(std::uint64_t n) { t_read += n; }
+    void add_written(std::uint64_t n) { t_written += n; }
+    void add_listed(std::uint64_t n) { t_listed += n; }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+namespace IoStats {
+    struct Snapshot {
+        std::uint64_t bytes_read = 0;    // file content read through the VFS
+        std::uint64_t bytes_written = 0; // file content written through the VFS
+        std::uint64_t dirs_listed = 0;   // directories read
+    };
+    // Totals for the calling thread so far; subtract two snapshots to
+    // measure a region of code.
+    Snapshot current();
+    void add_read(std::uint64_t n);
+    void add_written(std::uint64_t n);
+    void add_listed(std::uint64_t n);
+}
@@ -0,0 +1,103 @@
+#include "OutputSink.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+OutputSink::OutputSink(int fd, std::size_t capacity)
+    : fd_(fd), buf_(capacity) {
+    setp(buf_.data(), buf_.data() + buf_.size());
+}
+
+OutputSink::~OutputSink() {
+    flush();
+}
+
+OutputSink* OutputSink::of(std::ostream& os) {
+    return dynamic_cast<OutputSink*>(os.rdbuf());
+}
+
+void OutputSink::flush(std::ostream& os) {
+    os.flush();
+    if (auto* sink = of(os)) sink->flush();
+}
+
+bool OutputSink::flush() {
+    return write_out(nullptr, 0);
+}
+
+int OutputSink::sync() {
+    if (!line_buffered_) return 0;
+    return flush() ? 0 : -1;
+}
+
+OutputSink::int_type OutputSink::overflow(int_type ch) {
+    if (!write_out(nullptr, 0)) return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize OutputSink::xsputn(const char* s, std::streamsize n) {
+    auto len = static_cast<std::size_t>(n);
+    auto room = static_cast<std::size_t>(epptr() - pptr());
+    if (len <= room) {
+        std::memcpy(pptr(), s, len);
+        pbump(static_cast<int>(len));
+        return n;
+    }
+    // Large payloads go out together with the buffered prefix in one
+    // vectored write instead of being copied through the buffer.
+    if (len >= buf_.size() / 2) return write_out(s, len) ? n : 0;
+    if (!write_out(nullptr, 0)) return 0;
+    std::memcpy(pptr(), s, len);
+    pbump(static_cast<int>(len));
+    return n;
+}
+
+bool OutputSink::write_out(const char* extra, std::size_t extra_len) {
+    const char* head = pbase();
+    std::size_t head_len = static_cast<std::size_t>(pptr() - pbase());
+    setp(buf_.data(), buf_.data() + buf_.size());
+    bool ok = true;
+#ifdef _WIN32
+    auto write_all = [&](const char* p, std::size_t len) {
+        while (len > 0) {
+            int w = ::_write(fd_, p, static_cast<unsigned>(len));
+            if (w <= 0) return false;
+            p += w;
+            len -= static_cast<std::size_t>(w);
+        }
+        return true;
+    };
+    ok = write_all(head, head_len) && write_all(extra, extra_len);
+#else
+    struct iovec iov[2];
+    int cnt = 0;
+    if (head_len) iov[cnt++] = {const_cast<char*>(head), head_len};
+    if (extra_len) iov[cnt++] = {const_cast<char*>(extra), extra_len};
+    struct iovec* cur = iov;
+    while (cnt > 0) {
+        ssize_t w = ::writev(fd_, cur, cnt);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        auto done = static_cast<std::size_t>(w);
+        while (cnt > 0 && done >= cur->iov_len) { done -= cur->iov_len; ++cur; --cnt; }
+        if (cnt > 0) {
+            cur->iov_base = static_cast<char*>(cur->iov_base) + done;
+            cur->iov_len -= done;
+        }
+    }
+#endif
+    return ok;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+// Large-buffer streambuf over a file descriptor. Stream flushes
+// (std::endl, std::flush) are ignored unless the sink is line buffered,
+// so a command printing one line at a time costs one write per buffer
+// rather than one per line. Owners flush explicitly at the points where
+// output must be visible: end of a command, before a prompt, at exit.
+class OutputSink : public std::streambuf {
+public:
+    static constexpr std::size_t kDefaultCapacity = 64 * 1024;
+
+    explicit OutputSink(int fd, std::size_t capacity = kDefaultCapacity);
+    ~OutputSink() override;
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    // Write out everything buffered. Returns false on a write error.
+    bool flush();
+    // Honor stream flushes too; used when the descriptor is a terminal.
+    void set_line_buffered(bool on) { line_buffered_ = on; }
+    bool line_buffered() const { return line_buffered_; }
+    int fd() const { return fd_; }
+
+    // The sink behind `os`, or null when `os` writes somewhere else.
+    static OutputSink* of(std::ostream& os);
+    // Flush `os` and, if it is backed by a sink, its buffer as well.
+    static void flush(std::ostream& os);
+
+protected:
+    int sync() override;
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+private:
+    // Write the buffered bytes followed by [extra, extra + extra_len) with
+    // as few syscalls as possible (one writev in the common case).
+    bool write_out(const char* extra, std::size_t extra_len);
+
+    int fd_;
+    bool line_buffered_ = false;
+    std::vector<char> buf_;
+};
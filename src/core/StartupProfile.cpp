@@ -0,0 +1,53 @@
+#include "StartupProfile.hpp"
+
+#include <chrono>
+#include <iomanip>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Phase {
+        const char* name;
+        long long micros;
+    };
+
+    constexpr int kMaxPhases = 16;
+    bool g_enabled = false;
+    bool g_reported = false;
+    Clock::time_point g_start;
+    Clock::time_point g_last;
+    Phase g_phases[kMaxPhases];
+    int g_count = 0;
+}
+
+namespace StartupProfile {
+    void enable() {
+        g_enabled = true;
+        g_start = g_last = Clock::now();
+    }
+
+    bool enabled() { return g_enabled; }
+
+    void mark(const char* phase) {
+        if (!g_enabled || g_reported) return;
+        auto now = Clock::now();
+        if (g_count < kMaxPhases) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(now - g_last).count();
+            g_phases[g_count++] = Phase{phase, us};
+        }
+        g_last = now;
+    }
+
+    void report(std::ostream& out) {
+        if (!g_enabled || g_reported) return;
+        g_reported = true;
+        auto total = std::chrono::duration_cast<std::chrono::microseconds>(g_last - g_start).count();
+        out << "startup profile (us):" << '\n';
+        for (int i = 0; i < g_count; ++i) {
+            out << "  " << std::left << std::setw(24) << g_phases[i].name
+                << std::right << std::setw(8) << g_phases[i].micros << '\n';
+        }
+        out << "  " << std::left << std::setw(24) << "total"
+            << std::right << std::setw(8) << total << std::endl;
+    }
+}
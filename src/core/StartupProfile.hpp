@@ -0,0 +1,13 @@
+#pragma once
+#include <ostream>
+
+namespace StartupProfile {
+    // Turn on recording; the clock starts at the call.
+    void enable();
+    bool enabled();
+    // Record the time elapsed since the previous mark under `phase`.
+    // No-op unless enabled. `phase` must be a string literal.
+    void mark(const char* phase);
+    // Print the recorded phases once; later calls do nothing.
+    void report(std::ostream& out);
+}
@@ -0,0 +1,206 @@
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event {
+    const char* category;
+    std::int64_t ts_us;
+    std::int64_t dur_us;
+    char name[40];
+    char detail[104];
+};
+
+// Single-producer (owning thread) / single-consumer (flusher) ring.
+struct ThreadBuffer {
+    static constexpr std::uint32_t kCapacity = 4096; // power of two
+
+    explicit ThreadBuffer(std::uint32_t id) : tid(id) {}
+
+    bool push(const Event& e) {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= kCapacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & (kCapacity - 1)] = e;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::uint32_t tid;
+    std::atomic<std::uint32_t> head{0};
+    std::atomic<std::uint32_t> tail{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<bool> retired{false};
+    Event slots[kCapacity];
+};
+
+std::atomic<bool> g_enabled{false};
+Clock::time_point g_epoch;
+std::mutex g_mutex; // guards g_buffers, g_out and the flusher lifecycle
+std::vector<std::shared_ptr<ThreadBuffer>> g_buffers;
+std::uint32_t g_next_tid = 1;
+std::ofstream g_out;
+std::thread g_flusher;
+std::atomic<bool> g_stop{false};
+std::uint64_t g_retired_dropped = 0; // drops counted by buffers already freed
+bool g_first_event = true;
+
+// Marks the thread's buffer retired when the thread exits so the flusher
+// can drop it once drained.
+struct ThreadSlot {
+    std::shared_ptr<ThreadBuffer> buf;
+    ~ThreadSlot() { if (buf) buf->retired.store(true, std::memory_order_release); }
+};
+thread_local ThreadSlot t_slot;
+
+ThreadBuffer* thread_buffer() {
+    if (!t_slot.buf) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        t_slot.buf = std::make_shared<ThreadBuffer>(g_next_tid++);
+        g_buffers.push_back(t_slot.buf);
+    }
+    return t_slot.buf.get();
+}
+
+// Cuts at a UTF-8 code point boundary so the JSON stays valid.
+void copy_truncated(char* dst, size_t cap, std::string_view src) {
+    size_t n = std::min(src.size(), cap - 1);
+    if (n < src.size())
+        while (n > 0 && (static_cast<unsigned char>(src[n]) & 0xC0) == 0x80) --n;
+    std::memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+}
+
+void write_json_string(std::ostream& out, const char* s) {
+    out << '"';
+    for (; *s; ++s) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') out << '\\' << static_cast<char>(c);
+        else if (c < 0x20) {
+            char esc[8];
+            std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out << esc;
+        } else out << static_cast<char>(c);
+    }
+    out << '"';
+}
+
+// Caller holds g_mutex.
+void drain_locked() {
+    for (auto& buf : g_buffers) {
+        auto t = buf->tail.load(std::memory_order_relaxed);
+        auto h = buf->head.load(std::memory_order_acquire);
+        for (; t != h; ++t) {
+            const Event& e = buf->slots[t & (ThreadBuffer::kCapacity - 1)];
+            g_out << (g_first_event ? "\n" : ",\n");
+            g_first_event = false;
+            g_out << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << buf->tid
+                  << ",\"ts\":" << e.ts_us << ",\"dur\":" << e.dur_us << ",\"cat\":";
+            write_json_string(g_out, e.category);
+            g_out << ",\"name\":";
+            write_json_string(g_out, e.name);
+            if (e.detail[0]) {
+                g_out << ",\"args\":{\"detail\":";
+                write_json_string(g_out, e.detail);
+                g_out << '}';
+            }
+            g_out << '}';
+        }
+        buf->tail.store(h, std::memory_order_release);
+    }
+    g_buffers.erase(std::remove_if(g_buffers.begin(), g_buffers.end(), [](const std::shared_ptr<ThreadBuffer>& b) {
+        bool done = b->retired.load(std::memory_order_acquire)
+            && b->tail.load(std::memory_order_relaxed) == b->head.load(std::memory_order_acquire);
+        if (done) g_retired_dropped += b->dropped.load(std::memory_order_relaxed);
+        return done;
+    }), g_buffers.end());
+    g_out.flush();
+}
+
+void flusher_loop() {
+    while (!g_stop.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::lock_guard<std::mutex> lock(g_mutex);
+        drain_locked();
+    }
+}
+
+}
+
+namespace Trace {
+
+bool start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_enabled.load()) return false;
+    g_out.open(path, std::ios::binary | std::ios::trunc);
+    if (!g_out) return false;
+    // JSON array form: viewers accept a missing closing bracket, so a
+    // server that is killed still leaves a loadable file.
+    g_out << '[';
+    g_first_event = true;
+    g_retired_dropped = 0;
+    g_epoch = Clock::now();
+    g_stop.store(false);
+    g_enabled.store(true, std::memory_order_release);
+    g_flusher = std::thread(flusher_loop);
+    return true;
+}
+
+void stop() {
+    if (!g_enabled.exchange(false)) return;
+    g_stop.store(true, std::memory_order_release);
+    if (g_flusher.joinable()) g_flusher.join();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    drain_locked();
+    std::uint64_t dropped = g_retired_dropped;
+    for (auto& buf : g_buffers) dropped += buf->dropped.load();
+    if (dropped) {
+        g_out << (g_first_event ? "\n" : ",\n")
+              << "{\"ph\":\"i\",\"pid\":1,\"tid\":0,\"ts\":0,\"s\":\"g\",\"name\":\"dropped events\",\"args\":{\"count\":"
+              << dropped << "}}";
+    }
+    g_out << "\n]\n";
+    g_out.close();
+}
+
+bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+std::string label(const std::filesystem::path& p) {
+    return enabled() ? p.generic_string() : std::string();
+}
+
+Span::Span(const char* category, std::string_view name, std::string_view detail)
+    : category_(category), active_(enabled()) {
+    if (!active_) return;
+    copy_truncated(name_, sizeof(name_), name);
+    copy_truncated(detail_, sizeof(detail_), detail);
+    begin_ = Clock::now();
+}
+
+Span::~Span() {
+    if (!active_ || !enabled()) return;
+    auto end = Clock::now();
+    Event e;
+    e.category = category_;
+    e.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(begin_ - g_epoch).count();
+    e.dur_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin_).count();
+    std::memcpy(e.name, name_, sizeof(e.name));
+    std::memcpy(e.detail, detail_, sizeof(e.detail));
+    thread_buffer()->push(e);
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Chrome / Perfetto trace-event output, enabled by CORTEX_TRACE=<file>.
+// Spans are recorded into a lock-free per-thread ring buffer and written
+// to the file by a background flusher thread; a full buffer drops events
+// rather than blocking the traced thread.
+namespace Trace {
+    // Begin writing trace events to `path`. Returns false if the file
+    // cannot be opened or tracing is already running.
+    bool start(const std::string& path);
+    // Flush everything recorded so far and close the file.
+    void stop();
+    bool enabled();
+    // `p` in generic form, for a span name or detail. Empty while tracing
+    // is off, so untraced callers do not pay for the conversion.
+    std::string label(const std::filesystem::path& p);
+
+    // Records one complete ("X") event covering its lifetime. `category`
+    // must be a string literal; `name` and `detail` are copied (truncated)
+    // only while tracing is enabled.
+    class Span {
+    public:
+        Span(const char* category, std::string_view name, std::string_view detail = {});
+        ~Span();
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    private:
+        const char* category_;
+        bool active_;
+        std::chrono::steady_clock::time_point begin_;
+        char name_[40];
+        char detail_[104];
+    };
+}
@@ -1,10 +1,25 @@
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <filesystem>
 #include <string>
+#include <vector>
 
 #include "core/Environment.hpp"
+#include "core/OutputSink.hpp"
+#include "core/StartupProfile.hpp"
+#include "core/Trace.hpp"
 #include "vfs/FolderVfs.hpp"
+#include "vfs/TracingVfs.hpp"
 #include "shell/Shell.hpp"
+#include "shell/ScriptProfiler.hpp"
+#include "server/SessionServer.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 static std::filesystem::path default_root(bool portable) {
     namespace fs = std::filesystem;
@@ -22,79 +37,101 @@ static std::filesystem::path default_root(bool portable) {
 #endif
 }
 
-namespace Builtins {
-    std::unique_ptr<ICommand> make_pwd();
-    std::unique_ptr<ICommand> make_cd();
-    std::unique_ptr<ICommand> make_ls();
-    std::unique_ptr<ICommand> make_echo();
-    std::unique_ptr<ICommand> make_mkdir();
-    std::unique_ptr<ICommand> make_touch();
-    std::unique_ptr<ICommand> make_cat();
-    std::unique_ptr<ICommand> make_rm();
-    std::unique_ptr<ICommand> make_cp();
-    std::unique_ptr<ICommand> make_mv();
-    std::unique_ptr<ICommand> make_env();
-    std::unique_ptr<ICommand> make_set();
-    std::unique_ptr<ICommand> make_unset();
-    std::unique_ptr<ICommand> make_help();
-    std::unique_ptr<ICommand> make_version();
-    std::unique_ptr<ICommand> make_stat();
-    std::unique_ptr<ICommand> make_clear();
-    std::unique_ptr<ICommand> make_head();
-    std::unique_ptr<ICommand> make_tail();
-    std::unique_ptr<ICommand> make_find();
-    std::unique_ptr<ICommand> make_grep();
-    std::unique_ptr<ICommand> make_pack();
-    std::unique_ptr<ICommand> make_unpack();
-    std::unique_ptr<ICommand> make_chmod();
-    std::unique_ptr<ICommand> make_test();
-    std::unique_ptr<ICommand> make_bracket();
-    std::unique_ptr<ICommand> make_pkg();
+static constexpr int kStdoutFd = 1;
+
+static bool stdout_is_tty() {
+#ifdef _WIN32
+    return _isatty(kStdoutFd) != 0;
+#else
+    return ::isatty(kStdoutFd) != 0;
+#endif
 }
 
-namespace Builtins {
-    void register_all(CommandRegistry& reg) {
-        reg.add(make_pwd());
-        reg.add(make_cd());
-        reg.add(make_ls());
-        reg.add(make_echo());
-        reg.add(make_mkdir());
-        reg.add(make_touch());
-        reg.add(make_cat());
-        reg.add(make_rm());
-        reg.add(make_cp());
-        reg.add(make_mv());
-        reg.add(make_env());
-        reg.add(make_set());
-        reg.add(make_unset());
-        reg.add(make_help());
-        reg.add(make_version());
-        reg.add(make_stat());
-        reg.add(make_clear());
-        reg.add(make_head());
-        reg.add(make_tail());
-        reg.add(make_find());
-        reg.add(make_grep());
-        reg.add(make_pack());
-        reg.add(make_unpack());
-        reg.add(make_chmod());
-        reg.add(make_test());
-        reg.add(make_bracket());
-        reg.add(make_pkg());
-    }
+static void print_usage() {
+    std::cerr << "usage: cortex [--portable] [--startup-profile] [--profile-script[=FILE]] [-c COMMAND | SCRIPT [ARGS...]]" << std::endl;
+    std::cerr << "       cortex [--portable] --serve SOCKET" << std::endl;
+    std::cerr << "       cortex --connect SOCKET [-c COMMAND]" << std::endl;
 }
 
 int main(int argc, char** argv) {
     bool portable = false;
+    bool have_command = false;
+    std::string command;
+    std::string script;
+    std::vector<std::string> script_args;
+    std::string serve_socket;
+    std::string connect_socket;
+    bool profile_scripts = false;
+    std::string profile_out;
     for (int i = 1; i < argc; ++i) {
         std::string a = argv[i];
-        if (a == "--portable") portable = true;
+        if (!script.empty()) { script_args.push_back(a); continue; }
+        if (a == "--portable") { portable = true; continue; }
+        if (a == "--startup-profile") { StartupProfile::enable(); continue; }
+        if (a == "--profile-script") { profile_scripts = true; continue; }
+        if (a.rfind("--profile-script=", 0) == 0) { profile_scripts = true; profile_out = a.substr(17); continue; }
+        if (a == "-c") {
+            if (i + 1 >= argc) { print_usage(); return 2; }
+            command = argv[++i];
+            have_command = true;
+            continue;
+        }
+        if (a == "--serve" || a == "--connect") {
+            if (i + 1 >= argc) { print_usage(); return 2; }
+            (a == "--serve" ? serve_socket : connect_socket) = argv[++i];
+            continue;
+        }
+        if (!a.empty() && a[0] == '-') { print_usage(); return 2; }
+        script = a;
     }
 
+    if (!connect_socket.empty()) return server::connect(connect_socket, have_command ? &command : nullptr);
+
     Environment env;
 
-    FolderVfs vfs(default_root(portable));
+    // CORTEX_TRACE=<file>: write Chrome trace events for lines, pipeline
+    // stages, scripts and VFS calls.
+    struct TraceGuard { ~TraceGuard() { Trace::stop(); } } trace_guard;
+    if (const char* trace_path = std::getenv("CORTEX_TRACE")) {
+        if (*trace_path && !Trace::start(trace_path)) {
+            std::cerr << "cortex: cannot open trace file: " << trace_path << std::endl;
+        }
+    }
+
+    StartupProfile::mark("argument parsing");
+    FolderVfs folder_vfs(default_root(portable));
+    std::unique_ptr<TracingVfs> tracing_vfs;
+    if (Trace::enabled()) tracing_vfs = std::make_unique<TracingVfs>(folder_vfs);
+    IVfs& vfs = tracing_vfs ? static_cast<IVfs&>(*tracing_vfs) : folder_vfs;
+    StartupProfile::mark("vfs init");
+    if (!serve_socket.empty()) return server::serve(serve_socket, vfs);
 
-    Shell shell(std::cin, std::cout, vfs, env);
-    return shell.run();
+    // Shell output goes through a large buffer flushed at prompts and on
+    // exit; a terminal additionally gets line-at-a-time output.
+    OutputSink stdout_sink(kStdoutFd);
+    stdout_sink.set_line_buffered(stdout_is_tty());
+    std::ostream shell_out(&stdout_sink);
+    Shell shell(std::cin, shell_out, vfs, env);
+    StartupProfile::mark("register commands");
+    ScriptProfiler profiler;
+    if (profile_scripts) shell.set_profiler(&profiler);
+
+    int rc;
+    if (have_command || !script.empty()) {
+        StartupProfile::report(std::cerr);
+        rc = have_command ? shell.run_command(command) : shell.run_script(script, script_args);
+    } else {
+        rc = shell.run();
+    }
+
+    if (profile_scripts) {
+        if (profile_out.empty()) {
+            profiler.write_report(std::cerr);
+        } else {
+            std::ofstream ofs(profile_out, std::ios::binary | std::ios::trunc);
+            if (ofs) profiler.write_collapsed(ofs);
+            else std::cerr << "cortex: cannot write profile: " << profile_out << std::endl;
+        }
+    }
+    return rc;
 }
@@ -7,6 +7,8 @@
 #include <cctype>
 #include <fstream>
 #include <iterator>
+#include <map>
+#include <mutex>
 #include <sstream>
 
 namespace pkg {
@@ -25,6 +27,17 @@ bool looks_like_absolute_vfs_path(const std::string& path) {
     return !path.empty() && path.front() == '/';
 }
 
+// Successfully parsed indexes keyed by path, reused while the file's mtime
+// and size are unchanged so a long-lived process parses each index once.
+struct IndexCacheEntry {
+    std::filesystem::file_time_type mtime;
+    uintmax_t size = 0;
+    std::vector<Package> packages;
+};
+
+std::mutex g_index_mutex;
+std::map<std::string, IndexCacheEntry> g_index_cache;
+
 }
 
 Repository::Repository(std::filesystem::path root)
@@ -35,6 +48,19 @@ bool Repository::load() {
     error_.clear();
 
     auto index_path = root_ / "index.ini";
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(index_path, ec);
+    auto size = ec ? 0 : std::filesystem::file_size(index_path, ec);
+    bool cacheable = !ec;
+    if (cacheable) {
+        std::lock_guard<std::mutex> lock(g_index_mutex);
+        auto it = g_index_cache.find(index_path.string());
+        if (it != g_index_cache.end() && it->second.mtime == mtime && it->second.size == size) {
+            packages_ = it->second.packages;
+            return true;
+        }
+    }
+
     std::ifstream ifs(index_path);
     if (!ifs) {
         error_ = "repository index not found: " + index_path.string();
@@ -94,6 +120,10 @@ bool Repository::load() {
         if (!push_package(std::move(current))) return false;
     }
 
+    if (cacheable) {
+        std::lock_guard<std::mutex> lock(g_index_mutex);
+        g_index_cache[index_path.string()] = IndexCacheEntry{mtime, size, packages_};
+    }
     return true;
 }
 
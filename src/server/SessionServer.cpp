@@ -0,0 +1,277 @@
+#include "SessionServer.hpp"
+
+#include <iostream>
+
+#ifdef _WIN32
+
+namespace server {
+
+int serve(const std::filesystem::path&, IVfs&) {
+    std::cerr << "cortex: --serve is not supported on this platform" << std::endl;
+    return 1;
+}
+
+int connect(const std::filesystem::path&, const std::string*) {
+    std::cerr << "cortex: --connect is not supported on this platform" << std::endl;
+    return 1;
+}
+
+}
+
+#else
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <system_error>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../core/Environment.hpp"
+#include "../shell/Shell.hpp"
+
+namespace server {
+
+namespace {
+
+bool write_all(int fd, const char* data, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::send(fd, data, n, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool read_all(int fd, char* data, size_t n) {
+    while (n > 0) {
+        ssize_t r = ::recv(fd, data, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        data += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+bool write_frame(int fd, char type, const char* data, size_t n) {
+    char header[5];
+    header[0] = type;
+    auto len = static_cast<std::uint32_t>(n);
+    header[1] = static_cast<char>((len >> 24) & 0xff);
+    header[2] = static_cast<char>((len >> 16) & 0xff);
+    header[3] = static_cast<char>((len >> 8) & 0xff);
+    header[4] = static_cast<char>(len & 0xff);
+    return write_all(fd, header, sizeof(header)) && write_all(fd, data, n);
+}
+
+bool write_frame(int fd, char type, const std::string& payload) {
+    return write_frame(fd, type, payload.data(), payload.size());
+}
+
+bool read_frame(int fd, char& type, std::string& payload) {
+    unsigned char header[5];
+    if (!read_all(fd, reinterpret_cast<char*>(header), sizeof(header))) return false;
+    type = static_cast<char>(header[0]);
+    std::uint32_t len = (std::uint32_t(header[1]) << 24) | (std::uint32_t(header[2]) << 16)
+                      | (std::uint32_t(header[3]) << 8) | std::uint32_t(header[4]);
+    payload.resize(len);
+    return len == 0 || read_all(fd, &payload[0], len);
+}
+
+// Output stream buffer that ships its contents to the client as 'O'
+// frames whenever it fills up or is flushed.
+class FrameOutBuf : public std::streambuf {
+public:
+    explicit FrameOutBuf(int fd) : fd_(fd) { setp(buf_, buf_ + sizeof(buf_)); }
+protected:
+    int_type overflow(int_type ch) override {
+        if (!flush_buffer()) return traits_type::eof();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+    int sync() override { return flush_buffer() ? 0 : -1; }
+private:
+    bool flush_buffer() {
+        auto n = static_cast<size_t>(pptr() - pbase());
+        setp(buf_, buf_ + sizeof(buf_));
+        if (n == 0 || broken_) return !broken_;
+        if (!write_frame(fd_, kOutput, buf_, n)) broken_ = true;
+        return !broken_;
+    }
+    int fd_;
+    bool broken_ = false;
+    char buf_[16 * 1024];
+};
+
+void run_session(int fd, IVfs& vfs) {
+    {
+        Environment env;
+        std::istringstream no_input;
+        FrameOutBuf buf(fd);
+        std::ostream out(&buf);
+        Shell shell(no_input, out, vfs, env);
+        char type = 0;
+        std::string payload;
+        while (read_frame(fd, type, payload) && type == kCommand) {
+            int rc = shell.run_command(payload);
+            out.flush();
+            if (!write_frame(fd, kStatus, std::to_string(rc))) break;
+        }
+    }
+    ::close(fd);
+}
+
+// Counts running sessions so accept() waits while kMaxSessions are open.
+class SessionSlots {
+public:
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return used_ < kMaxSessions; });
+        ++used_;
+    }
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            --used_;
+        }
+        cv_.notify_one();
+    }
+
+private:
+    std::mutex mu_;
+    std::condition_variable cv_;
+    unsigned used_ = 0;
+};
+
+bool make_address(const std::filesystem::path& socket_path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    auto s = socket_path.string();
+    if (s.empty() || s.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, s.c_str(), s.size() + 1);
+    return true;
+}
+
+}
+
+int serve(const std::filesystem::path& socket_path, IVfs& vfs) {
+    sockaddr_un addr;
+    if (!make_address(socket_path, addr)) {
+        std::cerr << "cortex: invalid socket path: " << socket_path.string() << std::endl;
+        return 2;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) { std::cerr << "cortex: socket: " << std::strerror(errno) << std::endl; return 1; }
+    // Only a socket nobody answers on is left over from an earlier server;
+    // anything else at the path is not ours to remove
+    struct stat st;
+    if (::lstat(addr.sun_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            std::cerr << "cortex: " << socket_path.string() << " exists and is not a socket" << std::endl;
+            ::close(listen_fd);
+            return 1;
+        }
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        if (probe >= 0) ::close(probe);
+        if (live) {
+            std::cerr << "cortex: a server is already listening on " << socket_path.string() << std::endl;
+            ::close(listen_fd);
+            return 1;
+        }
+        ::unlink(addr.sun_path);
+    }
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd, SOMAXCONN) < 0) {
+        std::cerr << "cortex: cannot listen on " << socket_path.string() << ": " << std::strerror(errno) << std::endl;
+        ::close(listen_fd);
+        return 1;
+    }
+
+    // One thread per session, at most kMaxSessions at once; further
+    // clients wait in the listen backlog. Never freed: the server runs
+    // until killed.
+    static SessionSlots slots;
+    while (true) {
+        slots.acquire();
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            slots.release();
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "cortex: accept: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        try {
+            std::thread([fd, &vfs] { run_session(fd, vfs); slots.release(); }).detach();
+        } catch (const std::system_error&) {
+            ::close(fd);
+            slots.release();
+        }
+    }
+    ::close(listen_fd);
+    ::unlink(addr.sun_path);
+    return 1;
+}
+
+int connect(const std::filesystem::path& socket_path, const std::string* command) {
+    sockaddr_un addr;
+    if (!make_address(socket_path, addr)) {
+        std::cerr << "cortex: invalid socket path: " << socket_path.string() << std::endl;
+        return 2;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "cortex: cannot connect to " << socket_path.string() << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) ::close(fd);
+        return 1;
+    }
+
+    auto run = [&](const std::string& text) -> int {
+        if (!write_frame(fd, kCommand, text)) return -1;
+        char type = 0;
+        std::string payload;
+        while (read_frame(fd, type, payload)) {
+            if (type == kOutput) { std::cout.write(payload.data(), static_cast<std::streamsize>(payload.size())); continue; }
+            if (type == kStatus) { std::cout.flush(); return std::atoi(payload.c_str()); }
+        }
+        return -1;
+    };
+
+    int rc = 0;
+    if (command) {
+        rc = run(*command);
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (line == "exit" || line == "quit") break;
+            rc = run(line);
+            if (rc < 0) break;
+        }
+    }
+    ::close(fd);
+    if (rc < 0) { std::cerr << "cortex: connection to server lost" << std::endl; return 1; }
+    return rc;
+}
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+#include <filesystem>
+#include <string>
+
+class IVfs;
+
+namespace server {
+
+// Wire format shared by --serve and --connect. Every message is a frame:
+//   1 byte type, 4 byte big-endian payload length, payload.
+// Client -> server: 'C' script text to run in the session.
+// Server -> client: 'O' output bytes (any number), then 'S' with the
+// decimal exit status once the script has finished.
+enum FrameType : char {
+    kCommand = 'C',
+    kOutput = 'O',
+    kStatus = 'S',
+};
+
+// Listen on a Unix domain socket and serve one shell session per
+// connection, each with its own cwd, Environment and output stream, all
+// sharing `vfs` and the process-wide caches. At most kMaxSessions run at
+// once; later clients wait to be accepted. A stale socket at the path is
+// replaced, but not a live one or anything that is not a socket. Runs
+// until the process is killed; returns non-zero if the socket cannot be
+// set up.
+inline constexpr unsigned kMaxSessions = 64;
+int serve(const std::filesystem::path& socket_path, IVfs& vfs);
+
+// Thin client. With a command, runs it and returns its exit status.
+// Without one, sends each stdin line as a command until EOF or exit/quit.
+int connect(const std::filesystem::path& socket_path, const std::string* command);
+
+}
@@ -5,8 +5,12 @@
 #include <vector>
 #include <filesystem>
 
+#include "../core/CancelToken.hpp"
+
 class IVfs;
 class Environment;
+class CommandRegistry;
+class OutputSink;
 
 class CommandContext {
 public:
@@ -15,8 +19,9 @@ public:
                    std::ostream& out,
                    IVfs& vfs,
                    Environment& env,
-                   std::filesystem::path& cwd)
-        : args(args), in(in), out(out), vfs(vfs), env(env), cwd(cwd) {}
+                   std::filesystem::path& cwd,
+                   const CommandRegistry* registry = nullptr)
+        : args(args), in(in), out(out), vfs(vfs), env(env), cwd(cwd), registry(registry) {}
 
     const std::vector<std::string>& args;
     std::istream& in;
@@ -24,5 +29,11 @@ public:
     IVfs& vfs;
     Environment& env;
     std::filesystem::path& cwd; // VFS-internal cwd (absolute inside VFS, like /home/user)
+    const CommandRegistry* registry; // commands visible to this session (read-only)
+    CancelToken cancel; // poll cancel.cancelled() in long-running loops
+    // Descriptor-backed sink behind `out` when this stage writes straight to
+    // the shell's output; null when output is captured for a pipe or
+    // redirect. Flush it before writing to sink->fd() directly.
+    OutputSink* sink = nullptr;
 };
 
@@ -2,13 +2,21 @@
 
 void CommandRegistry::add(std::unique_ptr<ICommand> cmd) {
     auto key = cmd->name();
-    commands_[std::move(key)] = std::move(cmd);
+    commands_.erase(key);
+    commands_[std::move(key)].instance = std::move(cmd);
 }
 
-ICommand* CommandRegistry::find(const std::string& name) {
+void CommandRegistry::add(const std::string& name, Factory factory) {
+    commands_.erase(name);
+    commands_[name].factory = factory;
+}
+
+ICommand* CommandRegistry::find(const std::string& name) const {
     auto it = commands_.find(name);
     if (it == commands_.end()) return nullptr;
-    return it->second.get();
+    const auto& e = it->second;
+    std::call_once(e.once, [&e]{ if (!e.instance && e.factory) e.instance = e.factory(); });
+    return e.instance.get();
 }
 
 std::vector<std::string> CommandRegistry::list() const {
@@ -17,4 +25,3 @@ std::vector<std::string> CommandRegistry::list() const {
     for (auto& kv : commands_) names.push_back(kv.first);
     return names;
 }
-
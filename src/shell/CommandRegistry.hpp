@@ -1,17 +1,31 @@
 #pragma once
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "ICommand.hpp"
 
+// Name -> command table. Populate it with add() before sharing it; after
+// that it is read-only and find()/list() may be called from any number of
+// sessions concurrently. Command objects are shared between sessions, so
+// ICommand::execute must keep all per-call state in the CommandContext.
 class CommandRegistry {
 public:
+    using Factory = std::unique_ptr<ICommand> (*)();
+
     void add(std::unique_ptr<ICommand> cmd);
-    ICommand* find(const std::string& name);
+    // Register a command by name; the object is only constructed by the
+    // first find() for that name.
+    void add(const std::string& name, Factory factory);
+    ICommand* find(const std::string& name) const;
     std::vector<std::string> list() const;
 private:
-    std::map<std::string, std::unique_ptr<ICommand>> commands_;
+    struct Entry {
+        Factory factory = nullptr;
+        mutable std::once_flag once;
+        mutable std::unique_ptr<ICommand> instance;
+    };
+    std::map<std::string, Entry> commands_;
 };
-
@@ -0,0 +1,85 @@
+#include "GlobExpander.hpp"
+
+#include <algorithm>
+
+#include "../util/Glob.hpp"
+
+namespace {
+
+std::string join(const std::string& dir, std::string_view name) {
+    if (dir.empty()) return std::string(name);
+    std::string out = dir;
+    if (out.back() != '/') out += '/';
+    out += name;
+    return out;
+}
+
+}
+
+GlobExpander::GlobExpander(const IVfs& vfs, const std::filesystem::path& cwd)
+    : vfs_(vfs), cwd_(cwd) {}
+
+const std::vector<DirEntry>* GlobExpander::listing(const std::string& dir) {
+    std::filesystem::path host;
+    try { host = vfs_.resolveSecure(cwd_, dir.empty() ? std::string(".") : dir); }
+    catch (const std::exception&) { return nullptr; }
+    auto it = listings_.find(host.native());
+    if (it != listings_.end()) return &it->second;
+    std::vector<DirEntry> entries;
+    try { entries = vfs_.list(host); }
+    catch (const std::exception&) {}
+    std::sort(entries.begin(), entries.end(), [](const DirEntry& a, const DirEntry& b) { return a.name < b.name; });
+    return &listings_.emplace(host.native(), std::move(entries)).first->second;
+}
+
+size_t GlobExpander::expand(std::string_view pattern, std::vector<std::string>& out) {
+    std::vector<std::string_view> parts;
+    for (size_t start = 0; start <= pattern.size(); ) {
+        size_t slash = pattern.find('/', start);
+        if (slash == std::string_view::npos) slash = pattern.size();
+        if (slash > start) parts.push_back(pattern.substr(start, slash - start));
+        start = slash + 1;
+    }
+    const bool trailing_slash = !pattern.empty() && pattern.back() == '/';
+
+    std::vector<std::string> paths{pattern.substr(0, 1) == "/" ? "/" : ""};
+    bool last_was_literal = true;
+    for (size_t k = 0; k < parts.size(); ++k) {
+        const bool last = (k + 1 == parts.size());
+        if (!glob::has_wildcards(parts[k])) {
+            std::string lit = glob::unescape(parts[k]);
+            for (auto& p : paths) p = join(p, lit);
+            last_was_literal = true;
+            continue;
+        }
+        last_was_literal = false;
+        const glob::Pattern pat(parts[k]);
+        const bool match_dot = parts[k].front() == '.';
+        const bool need_dir = !last || trailing_slash;
+        std::vector<std::string> next;
+        for (const auto& dir : paths) {
+            const auto* entries = listing(dir);
+            if (!entries) continue;
+            for (const auto& e : *entries) {
+                if (e.name.front() == '.' && !match_dot) continue;
+                if (need_dir && !e.is_dir) continue;
+                if (!pat.match(e.name)) continue;
+                next.push_back(join(dir, e.name));
+            }
+        }
+        paths.swap(next);
+        if (paths.empty()) return 0;
+    }
+    if (last_was_literal) {
+        // Components after the last wildcard were taken on trust
+        std::error_code ec;
+        paths.erase(std::remove_if(paths.begin(), paths.end(), [&](const std::string& p) {
+            try { return !std::filesystem::exists(vfs_.resolveSecure(cwd_, p), ec); }
+            catch (const std::exception&) { return true; }
+        }), paths.end());
+    }
+    if (trailing_slash) for (auto& p : paths) p += '/';
+    std::sort(paths.begin(), paths.end());
+    for (auto& p : paths) out.push_back(std::move(p));
+    return paths.size();
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../vfs/IVfs.hpp"
+
+// Pathname expansion for the arguments of one command line. Directory
+// listings are cached for the expander's lifetime, so several patterns on a
+// line that touch the same directory (`cat logs/*.log logs/*.txt`) list it
+// once.
+class GlobExpander {
+public:
+    GlobExpander(const IVfs& vfs, const std::filesystem::path& cwd);
+
+    // Appends the VFS paths matching `pattern` (see glob::Pattern, applied
+    // per '/'-separated component) to `out` in sorted order and returns how
+    // many were added. Relative patterns give relative paths. A wildcard
+    // never matches a leading '.' unless the pattern component starts with
+    // one.
+    size_t expand(std::string_view pattern, std::vector<std::string>& out);
+
+private:
+    // Entries of the VFS directory `dir` (relative to cwd), sorted by name;
+    // null if it cannot be listed.
+    const std::vector<DirEntry>* listing(const std::string& dir);
+
+    const IVfs& vfs_;
+    const std::filesystem::path& cwd_;
+    std::unordered_map<std::string, std::vector<DirEntry>> listings_; // by host path
+};
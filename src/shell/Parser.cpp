@@ -1,31 +1,171 @@
 #include "Parser.hpp"
 
+#include <cctype>
+#include <cstring>
+
+#include "../util/Glob.hpp"
+
 namespace Parser {
 
-static void push_token(std::vector<std::string>& out, std::string& cur) {
-    if (!cur.empty()) {
-        out.push_back(cur);
-        cur.clear();
-    }
+namespace {
+
+bool is_glob_char(char c) { return c == '*' || c == '?' || c == '['; }
+bool is_blank(char c) { return c == ' ' || c == '\t'; }
+bool is_operator(char c) { return c == '|' || c == '<' || c == '>'; }
+
+// Length of a leading NAME= (identifier then '='), or 0.
+size_t assignment_prefix(std::string_view s) {
+    if (s.empty() || !(std::isalpha(static_cast<unsigned char>(s[0])) || s[0] == '_')) return 0;
+    size_t i = 1;
+    while (i < s.size() && (std::isalnum(static_cast<unsigned char>(s[i])) || s[i] == '_')) ++i;
+    return (i < s.size() && s[i] == '=') ? i + 1 : 0;
 }
 
-std::vector<std::string> split(const std::string& line) {
-    std::vector<std::string> args;
-    std::string cur;
-    bool in_single = false, in_double = false, escape = false;
-    for (size_t i = 0; i < line.size(); ++i) {
-        char c = line[i];
-        if (escape) { cur.push_back(c); escape = false; continue; }
-        if (c == '\\') { escape = true; continue; }
+std::string_view store(std::string_view s, std::pmr::memory_resource* mr) {
+    if (s.empty()) return {};
+    auto* p = static_cast<char*>(mr->allocate(s.size(), 1));
+    std::memcpy(p, s.data(), s.size());
+    return {p, s.size()};
+}
+
+}
+
+size_t substitution_end(std::string_view line, size_t i) {
+    if (i >= line.size()) return std::string_view::npos;
+    if (line[i] == '`') {
+        for (size_t j = i + 1; j < line.size(); ++j) {
+            if (line[j] == '\\') { ++j; continue; }
+            if (line[j] == '`') return j + 1;
+        }
+        return std::string_view::npos;
+    }
+    if (line[i] != '$' || i + 1 >= line.size() || line[i + 1] != '(') return std::string_view::npos;
+    int depth = 0;
+    bool in_single = false, in_double = false;
+    for (size_t j = i + 1; j < line.size(); ++j) {
+        char c = line[j];
+        if (c == '\\' && !in_single) { ++j; continue; }
         if (c == '\'' && !in_double) { in_single = !in_single; continue; }
         if (c == '"' && !in_single) { in_double = !in_double; continue; }
-        if (!in_single && !in_double) {
-            if (c == ' ' || c == '\t') { push_token(args, cur); continue; }
-            if (c == '|') { push_token(args, cur); args.emplace_back("|"); continue; }
+        if (in_single || in_double) continue;
+        if (c == '(') ++depth;
+        else if (c == ')' && --depth == 0) return j + 1;
+    }
+    return std::string_view::npos;
+}
+
+std::pmr::vector<Token> lex(std::string_view line, std::pmr::memory_resource* mr) {
+    std::pmr::vector<Token> tokens(mr);
+    // Scratch for words that need quotes or escapes removed; reused across
+    // words, and only the finished text is copied into `mr`.
+    std::pmr::string text(mr), pat(mr);
+    bool command_start = true;
+
+    size_t i = 0;
+    while (i < line.size()) {
+        if (is_blank(line[i])) { ++i; continue; }
+
+        if (is_operator(line[i])) {
+            Token op;
+            size_t len = 1;
+            if (line[i] == '|') op.kind = TokenKind::Pipe;
+            else if (line[i] == '<') op.kind = TokenKind::RedirectIn;
+            else if (i + 1 < line.size() && line[i + 1] == '>') { op.kind = TokenKind::RedirectAppend; len = 2; }
+            else op.kind = TokenKind::RedirectOut;
+            op.text = line.substr(i, len);
+            tokens.push_back(op);
+            command_start = (op.kind == TokenKind::Pipe);
+            i += len;
+            continue;
+        }
+
+        Token tok;
+        const size_t start = i;
+        bool copying = false;  // text/pat hold the word so far
+        bool only_subst = false;
+        bool in_single = false, in_double = false;
+        // Switch from viewing the line to building the word in scratch.
+        auto begin_copy = [&](size_t upto) {
+            if (copying) return;
+            copying = true;
+            // Everything before the first quote or escape was unquoted
+            text.assign(line.substr(start, upto - start));
+            pat.assign(text);
+        };
+        auto literal = [&](char c) {
+            text.push_back(c);
+            if (is_glob_char(c) || c == ']' || c == '\\') pat.push_back('\\');
+            pat.push_back(c);
+            only_subst = false;
+        };
+
+        while (i < line.size()) {
+            char c = line[i];
+            if (!in_single && !in_double && (is_blank(c) || is_operator(c))) break;
+            if (c == '\\' && !in_single) {
+                begin_copy(i);
+                tok.flags |= kQuoted;
+                if (i + 1 < line.size()) literal(line[i + 1]);
+                i += 2;
+                continue;
+            }
+            if ((c == '\'' && !in_double) || (c == '"' && !in_single)) {
+                begin_copy(i);
+                tok.flags |= kQuoted;
+                if (c == '\'') in_single = !in_single;
+                else in_double = !in_double;
+                ++i;
+                continue;
+            }
+            if (!in_single && (c == '`' || c == '$')) {
+                tok.flags |= kNeedsExpansion;
+                size_t end = substitution_end(line, i);
+                if (end != std::string_view::npos) {
+                    // Kept whole for the shell to run; quoting inside is its own.
+                    bool starts_word = (copying ? text.empty() : i == start) && !in_double;
+                    if (copying) { text.append(line.substr(i, end - i)); pat.append(line.substr(i, end - i)); }
+                    tok.flags |= kSubstitution;
+                    only_subst = starts_word;
+                    i = end;
+                    continue;
+                }
+            }
+            if (in_single || in_double) {
+                if (copying) literal(c);
+                only_subst = false;
+                ++i;
+                continue;
+            }
+            if (is_glob_char(c)) tok.flags |= kGlob;
+            if (copying) { text.push_back(c); pat.push_back(c); }
+            only_subst = false;
+            ++i;
         }
-        cur.push_back(c);
+
+        if (copying) {
+            tok.text = store(text, mr);
+            if (tok.has(kGlob)) tok.glob = store(pat, mr);
+        } else {
+            tok.text = line.substr(start, i - start);
+            if (tok.has(kGlob)) tok.glob = tok.text;
+        }
+        // A '[' with no ']' (the test builtin, say) is a literal, and a
+        // word with nothing else to match is not a pattern.
+        if (tok.has(kGlob) && !tok.has(kNeedsExpansion) && !glob::has_wildcards(tok.glob)) tok.flags &= ~kGlob;
+        if (tok.has(kNeedsExpansion)) tok.raw = line.substr(start, i - start);
+        if (tok.text.empty() && !tok.has(kQuoted)) continue;
+        if (only_subst) tok.flags |= kSplitFields;
+        if (command_start && assignment_prefix(line.substr(start, i - start)) > 0) tok.kind = TokenKind::Assignment;
+        command_start = false;
+        tokens.push_back(tok);
     }
-    push_token(args, cur);
+    return tokens;
+}
+
+std::vector<std::string> split(const std::string& line) {
+    std::pmr::monotonic_buffer_resource arena;
+    std::vector<std::string> args;
+    for (const auto& t : lex(line, &arena)) args.emplace_back(t.text);
     return args;
 }
 
@@ -1,9 +1,63 @@
 #pragma once
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace Parser {
-    // Split a line into args, handling simple quotes and escapes.
+    enum class TokenKind : unsigned char {
+        Word,
+        Assignment,     // NAME=value as the first word of a command
+        Pipe,           // |
+        RedirectIn,     // <
+        RedirectOut,    // >
+        RedirectAppend, // >>
+    };
+
+    enum TokenFlag : unsigned char {
+        kNeedsExpansion = 1, // has '$' or '`' outside single quotes
+        kQuoted = 2,         // quotes or escapes were removed from the text
+        kSubstitution = 4,   // has a $(...) or `...` outside single quotes
+        kSplitFields = 8,    // is exactly one unquoted substitution
+        kGlob = 16,          // has an unquoted '*', '?' or '['
+    };
+
+    struct Token {
+        TokenKind kind = TokenKind::Word;
+        unsigned char flags = 0;
+        // Text with quotes and escapes removed; substitutions are kept
+        // verbatim for the shell to run. A view into the line unless
+        // something had to be removed, in which case it lives in the
+        // lexer's memory resource.
+        std::string_view text;
+        // With kGlob: the token as a glob pattern, quoted characters
+        // backslash-escaped. Same storage as text. Words that need
+        // expansion get theirs from the shell, which escapes the output
+        // of substitutions too.
+        std::string_view glob;
+        // With kNeedsExpansion: the token as typed, quotes and escapes
+        // still in place, so expansion can tell which '$' and '`' were
+        // quoted. A view into the line.
+        std::string_view raw;
+
+        bool has(TokenFlag f) const { return (flags & f) != 0; }
+        bool is_redirect() const {
+            return kind == TokenKind::RedirectIn || kind == TokenKind::RedirectOut || kind == TokenKind::RedirectAppend;
+        }
+    };
+
+    // Single pass over `line`. Unquoted '|', '<', '>' and '>>' are operator
+    // tokens wherever they appear (a>b is three tokens); quoted they are
+    // ordinary word text. Empty quoted words ("") are kept. Views may point
+    // into `line` and into memory from `mr`; both must outlive the tokens,
+    // and `mr` is expected to be a per-line arena.
+    std::pmr::vector<Token> lex(std::string_view line, std::pmr::memory_resource* mr);
+
+    // Token texts of lex(line), operators included, as owned strings.
     std::vector<std::string> split(const std::string& line);
-}
 
+    // If line[i] opens a command substitution ("$(" or '`'), the index just
+    // past its matching close; npos when it is unterminated or when line[i]
+    // opens none. $(...) nests and skips quoted ')'.
+    size_t substitution_end(std::string_view line, size_t i);
+}
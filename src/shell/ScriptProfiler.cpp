@@ -0,0 +1,66 @@
+#include "ScriptProfiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+void ScriptProfiler::enter(const std::string& script, size_t line, std::string_view text) {
+    auto it = lines_.try_emplace(std::make_pair(script, line)).first;
+    if (it->second.text.empty()) it->second.text.assign(text);
+    stack_.push_back(Frame{it, Clock::now(), 0});
+}
+
+void ScriptProfiler::leave(int rc) {
+    if (stack_.empty()) return;
+    Frame f = stack_.back();
+    auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - f.start).count();
+    auto self = std::max<std::int64_t>(0, total - f.child_ns);
+
+    // Collapsed stack for this frame, outermost first
+    std::string key;
+    for (const auto& fr : stack_) {
+        if (!key.empty()) key.push_back(';');
+        key += fr.entry->first.first;
+        key.push_back(':');
+        key += std::to_string(fr.entry->first.second);
+    }
+    collapsed_ns_[key] += self;
+
+    stack_.pop_back();
+    auto& stats = f.entry->second;
+    ++stats.hits;
+    if (rc != 0) ++stats.failed;
+    stats.total_ns += total;
+    stats.self_ns += self;
+    if (!stack_.empty()) stack_.back().child_ns += total;
+}
+
+void ScriptProfiler::write_report(std::ostream& out, size_t max_rows) const {
+    std::vector<const LineMap::value_type*> rows;
+    rows.reserve(lines_.size());
+    for (const auto& kv : lines_) rows.push_back(&kv);
+    std::sort(rows.begin(), rows.end(), [](const auto* a, const auto* b) {
+        if (a->second.self_ns != b->second.self_ns) return a->second.self_ns > b->second.self_ns;
+        return a->first < b->first;
+    });
+    if (rows.size() > max_rows) rows.resize(max_rows);
+
+    auto ms = [](std::int64_t ns) { return static_cast<double>(ns) / 1e6; };
+    out << "script profile (sorted by self time):" << '\n';
+    out << std::right << std::setw(10) << "self_ms" << std::setw(10) << "total_ms"
+        << std::setw(8) << "hits" << std::setw(8) << "failed" << "  location" << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (const auto* row : rows) {
+        const auto& st = row->second;
+        out << std::setw(10) << ms(st.self_ns) << std::setw(10) << ms(st.total_ns)
+            << std::setw(8) << st.hits << std::setw(8) << st.failed
+            << "  " << row->first.first << ':' << row->first.second << "  " << st.text << '\n';
+    }
+    out << std::defaultfloat << std::flush;
+}
+
+void ScriptProfiler::write_collapsed(std::ostream& out) const {
+    for (const auto& kv : collapsed_ns_) {
+        out << kv.first << ' ' << (kv.second / 1000) << '\n';
+    }
+    out.flush();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Per-line statistics for script execution (cortex --profile-script).
+// Lines are keyed by script path and 1-based line number. Self time
+// excludes time spent in lines of scripts called from that line. One
+// profiler belongs to one Shell and is not thread-safe.
+class ScriptProfiler {
+public:
+    // Times one script line from construction to destruction. A null
+    // profiler makes it a no-op.
+    class LineScope {
+    public:
+        LineScope(ScriptProfiler* profiler, const std::string& script, size_t line, std::string_view text)
+            : profiler_(profiler) { if (profiler_) profiler_->enter(script, line, text); }
+        ~LineScope() { if (profiler_) profiler_->leave(status_); }
+        LineScope(const LineScope&) = delete;
+        LineScope& operator=(const LineScope&) = delete;
+        void set_status(int rc) { status_ = rc; }
+    private:
+        ScriptProfiler* profiler_;
+        int status_ = 0;
+    };
+
+    // Hot-spot table sorted by self time, at most `max_rows` rows.
+    void write_report(std::ostream& out, size_t max_rows = 40) const;
+    // Collapsed stacks ("a.sh:3;b.sh:7 <self microseconds>") for
+    // flamegraph.pl / speedscope / inferno.
+    void write_collapsed(std::ostream& out) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct LineStats {
+        std::uint64_t hits = 0;
+        std::uint64_t failed = 0;
+        std::int64_t total_ns = 0;
+        std::int64_t self_ns = 0;
+        std::string text;
+    };
+    using LineMap = std::map<std::pair<std::string, size_t>, LineStats>;
+    struct Frame {
+        LineMap::iterator entry;
+        Clock::time_point start;
+        std::int64_t child_ns;
+    };
+
+    void enter(const std::string& script, size_t line, std::string_view text);
+    void leave(int rc);
+
+    LineMap lines_;
+    std::map<std::string, std::int64_t> collapsed_ns_;
+    std::vector<Frame> stack_;
+};
@@ -1,51 +1,125 @@
 #include "Shell.hpp"
 
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <csignal>
+#include <iomanip>
 #ifdef _WIN32
 #  include <windows.h>
 #endif
 
 #include "Parser.hpp"
+#include "GlobExpander.hpp"
+#include "ScriptProfiler.hpp"
 #include "ICommand.hpp"
 #include "CommandContext.hpp"
 #include "../vfs/IVfs.hpp"
 #include "../core/Environment.hpp"
 #include "../core/Interrupt.hpp"
+#include "../core/StartupProfile.hpp"
+#include "../core/AllocStats.hpp"
+#include "../core/CpuTime.hpp"
+#include "../core/IoStats.hpp"
+#include "../core/OutputSink.hpp"
+#include "../core/Trace.hpp"
+#include "../util/ExecDb.hpp"
+#include "../util/Glob.hpp"
 
 // Forward declare factory to register commands
 namespace Builtins { void register_all(CommandRegistry& reg); }
-// Expose registry for Help command
-CommandRegistry* g_registry_for_help = nullptr;
 
-// SIGINT (Ctrl+C) handling
-static std::atomic<bool> s_interrupted{false};
-static void on_sigint(int) { s_interrupted.store(true); Interrupt::set(); }
+// SIGINT (Ctrl+C) handling: the interactive shell points this at its own
+// interrupt flag while run() is active.
+static std::atomic<Interrupt::Flag*> s_sigint_target{nullptr};
+static void on_sigint(int) {
+    if (auto* flag = s_sigint_target.load()) flag->store(true);
+}
 
 #ifdef _WIN32
 static BOOL WINAPI on_console_ctrl(DWORD type) {
     if (type == CTRL_C_EVENT) {
-        s_interrupted.store(true);
-        Interrupt::set();
+        on_sigint(SIGINT);
         return TRUE; // handled; do not terminate process
     }
     return FALSE;
 }
 #endif
 
+const CommandRegistry& Shell::builtin_registry() {
+    static const CommandRegistry registry = []{
+        CommandRegistry reg;
+        Builtins::register_all(reg);
+        return reg;
+    }();
+    return registry;
+}
+
 Shell::Shell(std::istream& in, std::ostream& out, IVfs& vfs, Environment& env)
-    : in_(in), out_(out), vfs_(vfs), env_(env) {
+    : Shell(in, out, vfs, env, builtin_registry()) {}
+
+Shell::Shell(std::istream& in, std::ostream& out, IVfs& vfs, Environment& env, const CommandRegistry& registry)
+    : in_(in), out_(out), vfs_(vfs), env_(env), registry_(registry) {
     // Default cwd
     cwd_ = std::filesystem::path("/");
-    register_builtin_commands();
 }
 
-void Shell::register_builtin_commands() {
-    Builtins::register_all(registry_);
-    g_registry_for_help = &registry_;
+// Resource usage of the calling thread at one instant; used by `time`.
+namespace {
+struct UsageSample {
+    std::chrono::steady_clock::time_point wall;
+    CpuTime::Times cpu;
+    AllocStats::Snapshot alloc;
+    IoStats::Snapshot io;
+
+    static UsageSample take() {
+        UsageSample u;
+        u.alloc = AllocStats::current();
+        u.io = IoStats::current();
+        u.cpu = CpuTime::thread_times();
+        u.wall = std::chrono::steady_clock::now();
+        return u;
+    }
+};
+
+struct StageUsage {
+    std::string name;
+    UsageSample begin;
+    UsageSample end;
+    long long piped; // bytes handed to the next stage, -1 for the last one
+};
+
+void print_time_report(std::ostream& out, const std::vector<StageUsage>& stages) {
+    auto ms = [](long long us) { return static_cast<double>(us) / 1000.0; };
+    out << std::left << std::setw(4) << "#" << std::setw(10) << "command" << std::right
+        << std::setw(10) << "wall_ms" << std::setw(10) << "user_ms" << std::setw(10) << "sys_ms"
+        << std::setw(9) << "allocs" << std::setw(12) << "alloc_B" << std::setw(12) << "vfs_rd_B"
+        << std::setw(12) << "vfs_wr_B" << std::setw(8) << "dirs" << std::setw(12) << "piped_B" << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const auto& st = stages[i];
+        auto wall_us = std::chrono::duration_cast<std::chrono::microseconds>(st.end.wall - st.begin.wall).count();
+        out << std::left << std::setw(4) << (i + 1) << std::setw(10) << st.name << std::right
+            << std::setw(10) << ms(wall_us)
+            << std::setw(10) << ms(st.end.cpu.user_us - st.begin.cpu.user_us)
+            << std::setw(10) << ms(st.end.cpu.sys_us - st.begin.cpu.sys_us)
+            << std::setw(9) << (st.end.alloc.count - st.begin.alloc.count)
+            << std::setw(12) << (st.end.alloc.bytes - st.begin.alloc.bytes)
+            << std::setw(12) << (st.end.io.bytes_read - st.begin.io.bytes_read)
+            << std::setw(12) << (st.end.io.bytes_written - st.begin.io.bytes_written)
+            << std::setw(8) << (st.end.io.dirs_listed - st.begin.io.dirs_listed)
+            << std::setw(12);
+        if (st.piped < 0) out << "-"; else out << st.piped;
+        out << '\n';
+    }
+    out << std::defaultfloat << std::flush;
+}
 }
 
 // String helpers
@@ -54,62 +128,122 @@ static std::string s_rtrim(const std::string& s){ size_t j=s.size(); while(j>0 &
 std::string Shell::ltrim(const std::string& s){ return s_ltrim(s); }
 std::string Shell::rtrim(const std::string& s){ return s_rtrim(s); }
 std::string Shell::trim(const std::string& s){ return s_rtrim(s_ltrim(s)); }
+std::string_view Shell::trim_view(std::string_view s){
+    size_t i=0; while(i<s.size() && std::isspace(static_cast<unsigned char>(s[i]))) ++i;
+    size_t j=s.size(); while(j>i && std::isspace(static_cast<unsigned char>(s[j-1]))) --j;
+    return s.substr(i, j-i);
+}
 
-std::string Shell::expand_vars(const std::string& input, const Environment& env) {
-    std::string out;
-    out.reserve(input.size());
-    for (size_t i = 0; i < input.size(); ) {
-        char c = input[i];
-        if (c == '$') {
-            if (i + 1 < input.size() && input[i+1] == '{') {
-                size_t j = i + 2; // after ${
-                while (j < input.size() && input[j] != '}') ++j;
-                if (j < input.size()) {
-                    std::string key = input.substr(i + 2, j - (i + 2));
-                    out += env.get(key);
-                    i = j + 1;
-                    continue;
-                }
-                // no closing }, treat as literal
-            } else {
-                // $VAR form (including $? and numeric positional $1..$9)
-                size_t j = i + 1;
-                if (j < input.size() && input[j] == '?') {
-                    out += env.get("?");
-                    i = j + 1;
-                    continue;
-                }
-                if (j < input.size() && (std::isalpha(static_cast<unsigned char>(input[j])) || input[j] == '_' || std::isdigit(static_cast<unsigned char>(input[j])))) {
-                    ++j;
-                    while (j < input.size() && (std::isalnum(static_cast<unsigned char>(input[j])) || input[j] == '_')) ++j;
-                    std::string key = input.substr(i + 1, j - (i + 1));
-                    out += env.get(key);
-                    i = j;
+// Expands one word as typed, quotes and escapes included (Token::raw),
+// removing them as it goes: $VAR, ${VAR}, $? and substitutions are
+// expanded only outside single quotes and when their '$' or '`' is not
+// escaped, and a variable name ends at a closing quote. `pat`, if given,
+// receives the same word as a glob pattern in which unquoted text and
+// unquoted variable values keep their wildcards. It is only asked for
+// when the word has a wildcard typed outside quotes (Parser's kGlob), so
+// with X='*.txt', echo $X prints *.txt while echo $X* globs.
+template <class Str, class Subst>
+static void expand_word_into(std::string_view raw, const Environment& env, Str& text, Str* pat, const Subst& subst) {
+    text.reserve(text.size() + raw.size());
+    // Appends text[from, end) to the pattern, escaped if `quoted`
+    auto to_pat = [&](size_t from, bool quoted) {
+        if (!pat) return;
+        for (size_t k = from; k < text.size(); ++k) {
+            char c = text[k];
+            if (quoted && (c == '*' || c == '?' || c == '[' || c == ']' || c == '\\')) pat->push_back('\\');
+            pat->push_back(c);
+        }
+    };
+    std::string key;
+    bool in_single = false, in_double = false;
+    for (size_t i = 0; i < raw.size(); ) {
+        const char c = raw[i];
+        const size_t before = text.size();
+        if (c == '\\' && !in_single) {
+            if (i + 1 < raw.size()) text.push_back(raw[i + 1]);
+            to_pat(before, true);
+            i += 2;
+            continue;
+        }
+        if ((c == '\'' && !in_double) || (c == '"' && !in_single)) {
+            if (c == '\'') in_single = !in_single;
+            else in_double = !in_double;
+            ++i;
+            continue;
+        }
+        if (!in_single && (c == '`' || (c == '$' && i + 1 < raw.size() && raw[i+1] == '('))) {
+            size_t end = Parser::substitution_end(raw, i);
+            if (end != std::string_view::npos) {
+                size_t open = (c == '`') ? 1 : 2;
+                if (!subst(raw.substr(i + open, end - i - open - 1), text)) text.append(raw.data() + i, end - i);
+                to_pat(before, true); // output is data, never a pattern
+                i = end;
+                continue;
+            }
+        }
+        if (!in_single && c == '$') {
+            size_t j = i + 1;
+            if (j < raw.size() && raw[j] == '{') {
+                size_t close = raw.find('}', j);
+                if (close != std::string_view::npos) {
+                    key.assign(raw.substr(j + 1, close - j - 1));
+                    text += env.get(key);
+                    to_pat(before, in_double);
+                    i = close + 1;
                     continue;
                 }
+            } else if (j < raw.size() && raw[j] == '?') {
+                text += env.get("?");
+                to_pat(before, in_double);
+                i = j + 1;
+                continue;
+            } else if (j < raw.size() && (std::isalpha(static_cast<unsigned char>(raw[j])) || raw[j] == '_' || std::isdigit(static_cast<unsigned char>(raw[j])))) {
+                ++j;
+                while (j < raw.size() && (std::isalnum(static_cast<unsigned char>(raw[j])) || raw[j] == '_')) ++j;
+                key.assign(raw.substr(i + 1, j - i - 1));
+                text += env.get(key);
+                to_pat(before, in_double);
+                i = j;
+                continue;
             }
         }
-        out.push_back(c);
+        text.push_back(c);
+        to_pat(before, in_single || in_double);
         ++i;
     }
+}
+
+std::pmr::string Shell::expand_word(std::string_view raw, const Environment& env, std::pmr::memory_resource* mr, std::pmr::string* pat) {
+    std::pmr::string out(mr);
+    expand_word_into(raw, env, out, pat, [&](std::string_view command, std::pmr::string& dest) {
+        capture_output(command, env, dest);
+        return true;
+    });
     return out;
 }
 
-bool Shell::has_exec_permission(const std::filesystem::path& host_path) const {
+void Shell::capture_output(std::string_view command, const Environment& env, std::pmr::string& out) {
+    // Subshell semantics: assignments and cd inside stay inside
+    Environment sub_env = env;
+    auto saved_cwd = cwd_;
+    std::ostringstream captured;
+    auto* prev = out_.rdbuf(captured.rdbuf());
     try {
-        auto execdb = vfs_.resolveSecure(std::filesystem::path("/"), std::filesystem::path("/etc/execdb"));
-        auto data = vfs_.readFile(execdb);
-        std::istringstream is(data);
-        std::string line;
-        auto target = host_path.generic_string();
-        while (std::getline(is, line)) {
-            line = trim(line);
-            if (line == target) return true;
-        }
-    } catch (const std::exception&) {
-        // no db yet
+        execute_line_with_env(std::string(command), sub_env);
+    } catch (...) {
+        out_.rdbuf(prev);
+        cwd_ = std::move(saved_cwd);
+        throw;
     }
-    return false;
+    out_.rdbuf(prev);
+    cwd_ = std::move(saved_cwd);
+    auto text = captured.str();
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+    out += text;
+}
+
+bool Shell::has_exec_permission(const std::filesystem::path& host_path) const {
+    return execdb::contains(vfs_, host_path);
 }
 
 int Shell::execute_line(const std::string& line) {
@@ -117,45 +251,121 @@ int Shell::execute_line(const std::string& line) {
 }
 
 int Shell::execute_line_with_env(const std::string& raw_line, Environment& active_env) {
-    auto raw = trim(raw_line);
+    auto raw = trim_view(raw_line);
     if (raw.empty()) return 0;
     if (!raw.empty() && raw[0] == '#') return 0;
+    Trace::Span line_span("line", raw);
     if (active_env.get("?").empty()) active_env.set("?", "0");
 
-    // Simple variable assignment KEY=VALUE (no spaces around '=')
-    {
-        auto pos = raw.find('=');
-        if (pos != std::string::npos) {
-            bool has_space = (raw.find(' ') != std::string::npos) || (raw.find('\t') != std::string::npos);
-            if (!has_space) {
-                std::string key = raw.substr(0, pos);
-                std::string val = raw.substr(pos + 1);
-                // Strip symmetrical quotes
-                if (val.size() >= 2 && ((val.front() == '"' && val.back() == '"') || (val.front() == '\'' && val.back() == '\''))) {
-                    val = val.substr(1, val.size()-2);
-                }
-                val = expand_vars(val, active_env);
-                active_env.set(key, val);
-                return 0;
+    // Per-line arena: tokens, expansions, segments and redirection targets
+    // are all released at once when this invocation returns.
+    std::byte arena_buf[kLineArenaBytes];
+    std::pmr::monotonic_buffer_resource arena(arena_buf, sizeof(arena_buf));
+    using Parser::Token;
+    using Parser::TokenKind;
+    using Tokens = std::pmr::vector<Token>;
+
+    // Token texts are views into the line or the arena; expansion results
+    // are copied into the arena so later views stay valid.
+    auto keep = [&](std::string_view s) -> std::string_view {
+        if (s.empty()) return {};
+        auto* p = static_cast<char*>(arena.allocate(s.size(), 1));
+        std::memcpy(p, s.data(), s.size());
+        return {p, s.size()};
+    };
+
+    Tokens tokens = Parser::lex(raw, &arena);
+    if (tokens.empty()) return 0;
+
+    // Expansion, driven by the lexer's flags: only words where a '$' or
+    // '`' appeared outside single quotes are expanded, from the text as
+    // typed so that quoting still applies. Everything else is used as
+    // lexed.
+    bool any_glob = false, any_fields = false;
+    for (auto& t : tokens) {
+        if (t.kind != TokenKind::Word && t.kind != TokenKind::Assignment) continue;
+        any_glob = any_glob || t.has(Parser::kGlob);
+        if (!t.has(Parser::kNeedsExpansion)) continue;
+        std::pmr::string pat(&arena);
+        t.text = keep(expand_word(t.raw, active_env, &arena, t.has(Parser::kGlob) ? &pat : nullptr));
+        if (t.has(Parser::kGlob)) {
+            t.glob = keep(pat);
+            if (!glob::has_wildcards(t.glob)) t.flags &= ~Parser::kGlob;
+        }
+        any_fields = any_fields || t.has(Parser::kSplitFields);
+    }
+
+    // Simple variable assignment: the whole line is one NAME=value word
+    if (tokens.size() == 1 && tokens[0].kind == TokenKind::Assignment) {
+        auto eq = tokens[0].text.find('=');
+        active_env.set(std::string(tokens[0].text.substr(0, eq)), std::string(tokens[0].text.substr(eq + 1)));
+        return 0;
+    }
+
+    // An unquoted substitution that forms a whole word becomes one argument
+    // per whitespace-separated field of its output (none if it is empty).
+    if (any_fields) {
+        Tokens fields(&arena);
+        for (const auto& t : tokens) {
+            if (!t.has(Parser::kSplitFields)) { fields.push_back(t); continue; }
+            size_t pos = 0;
+            while ((pos = t.text.find_first_not_of(" \t\r\n", pos)) != std::string_view::npos) {
+                size_t end = std::min(t.text.find_first_of(" \t\r\n", pos), t.text.size());
+                Token field;
+                field.text = t.text.substr(pos, end - pos);
+                fields.push_back(field);
+                pos = end;
             }
         }
+        tokens.swap(fields);
+        if (tokens.empty()) return 0;
     }
 
-    auto tokens = Parser::split(raw);
-    if (tokens.empty()) return 0;
+    // Pathname expansion. Redirection targets are left alone, and a
+    // pattern that matches nothing is passed on as typed.
+    if (any_glob) {
+        GlobExpander expander(vfs_, cwd_);
+        Tokens expanded(&arena);
+        std::vector<std::string> matches;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            const auto& t = tokens[i];
+            bool redirect_target = i > 0 && tokens[i-1].is_redirect();
+            matches.clear();
+            if (!t.has(Parser::kGlob) || redirect_target || expander.expand(t.glob, matches) == 0) {
+                expanded.push_back(t);
+                continue;
+            }
+            for (const auto& m : matches) {
+                Token match;
+                match.text = keep(m);
+                expanded.push_back(match);
+            }
+        }
+        tokens.swap(expanded);
+    }
 
-    // Variable expansion in tokens (MVP: expand everywhere)
-    for (auto& t : tokens) {
-        if (t == "|" || t == "<" || t == ">" || t == ">>") continue;
-        t = expand_vars(t, active_env);
+    // Built-in: time <pipeline> reports per-stage resource usage
+    bool timed = false;
+    if (tokens[0].kind == TokenKind::Word && tokens[0].text == "time") {
+        tokens.erase(tokens.begin());
+        if (tokens.empty()) { out_ << "time: usage: time <pipeline>" << std::endl; return 2; }
+        timed = true;
     }
+    // A script or `source` is timed as one stage
+    auto run_timed_script = [&](std::string_view name, auto run) {
+        UsageSample begin;
+        if (timed) begin = UsageSample::take();
+        int rc = run();
+        if (timed) print_time_report(out_, {StageUsage{std::string(name), begin, UsageSample::take(), -1}});
+        return rc;
+    };
 
     // Built-in: source <path>
-    if (!tokens.empty() && tokens[0] == "source") {
+    if (tokens[0].kind == TokenKind::Word && tokens[0].text == "source") {
         if (tokens.size() < 2) { out_ << "source: missing path" << std::endl; return 2; }
         try {
-            auto abs = vfs_.resolveSecure(cwd_, tokens[1]);
-            int rc = execute_script_file(abs, /*source_mode*/true, active_env);
+            auto abs = vfs_.resolveSecure(cwd_, tokens[1].text);
+            int rc = run_timed_script("source", [&] { return execute_script_file(abs, /*source_mode*/true, active_env); });
             active_env.set("?", std::to_string(rc));
             return rc;
         } catch (const std::exception& e) {
@@ -165,16 +375,17 @@ int Shell::execute_line_with_env(const std::string& raw_line, Environment& activ
 
     // Direct script execution by path
     try {
-        const std::string& cmd0 = tokens[0];
-        bool looks_like_path = !cmd0.empty() && (cmd0[0] == '/' || cmd0[0] == '.' || cmd0.find('/') != std::string::npos);
+        std::string_view cmd0 = tokens[0].text;
+        bool looks_like_path = tokens[0].kind == TokenKind::Word && !cmd0.empty()
+            && (cmd0[0] == '/' || cmd0[0] == '.' || cmd0.find('/') != std::string_view::npos);
         if (looks_like_path) {
             auto abs = vfs_.resolveSecure(cwd_, cmd0);
             auto st = vfs_.stat(abs);
             if (!st.is_dir) {
                 if (!has_exec_permission(abs)) { out_ << "permission denied: " << cmd0 << std::endl; return 126; }
                 std::vector<std::string> args;
-                if (tokens.size() > 1) args.assign(tokens.begin()+1, tokens.end());
-                int rc = execute_script_file(abs, /*source_mode*/false, active_env, args);
+                for (size_t i = 1; i < tokens.size(); ++i) args.emplace_back(tokens[i].text);
+                int rc = run_timed_script(cmd0, [&] { return execute_script_file(abs, /*source_mode*/false, active_env, args); });
                 active_env.set("?", std::to_string(rc));
                 return rc;
             }
@@ -183,61 +394,52 @@ int Shell::execute_line_with_env(const std::string& raw_line, Environment& activ
         // fallthrough
     }
 
-    // Split by pipeline '|'
-    std::vector<std::vector<std::string>> segments(1);
-    for (const auto& t : tokens) {
-        if (t == "|") segments.emplace_back();
-        else segments.back().push_back(t);
-    }
-    if (segments.empty() || segments[0].empty()) return 0;
-
-    // Parse redirections: input '<' on first; output '>'/ '>>' on last
-    auto parse_redir = [](const std::vector<std::string>& in,
-                          bool allow_in, bool allow_out,
-                          std::vector<std::string>& args,
-                          std::string& in_file,
-                          std::string& out_file,
-                          bool& out_append) -> int {
-        args.clear(); in_file.clear(); out_file.clear(); out_append = false;
-        for (size_t i = 0; i < in.size(); ++i) {
-            const std::string& tok = in[i];
-            if (allow_in && (tok == "<" || (!tok.empty() && tok[0] == '<'))) {
-                std::string rest = (tok == "<" ? std::string() : tok.substr(1));
-                if (rest.empty()) {
-                    if (i + 1 >= in.size()) return 2; // missing target
-                    in_file = in[++i];
-                } else in_file = rest;
-                continue;
+    // Split into pipeline stages and take the redirections out: input '<'
+    // on the first stage, output '>' / '>>' on the last. Elsewhere an
+    // operator and its target are passed to the command as plain args.
+    using Args = std::pmr::vector<std::string_view>;
+    std::pmr::vector<Args> segments(&arena);
+    segments.emplace_back();
+    size_t stage_count = 1;
+    for (const auto& t : tokens) stage_count += (t.kind == TokenKind::Pipe);
+    std::string_view first_in_file, last_out_file;
+    bool last_out_append = false;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const auto& t = tokens[i];
+        if (t.kind == TokenKind::Pipe) {
+            if (segments.back().empty()) { out_ << "syntax error: empty command" << std::endl; return 2; }
+            segments.emplace_back();
+            continue;
+        }
+        if (t.is_redirect()) {
+            if (i + 1 >= tokens.size() || tokens[i+1].kind == TokenKind::Pipe || tokens[i+1].is_redirect()) {
+                out_ << "syntax error: missing redirection target" << std::endl; return 2;
             }
-            if (allow_out && (tok == ">" || tok == ">>" || (!tok.empty() && tok[0] == '>'))) {
-                out_append = (tok == ">>") || (tok.rfind(">>", 0) == 0);
-                std::string rest = (tok == ">" || tok == ">>" ? std::string() : tok.substr(out_append ? 2 : 1));
-                if (rest.empty()) {
-                    if (i + 1 >= in.size()) return 2; // missing target
-                    out_file = in[++i];
-                } else out_file = rest;
+            bool first = segments.size() == 1, last = segments.size() == stage_count;
+            std::string_view target = tokens[++i].text;
+            if (t.kind == TokenKind::RedirectIn && first) { first_in_file = target; continue; }
+            if (t.kind != TokenKind::RedirectIn && last) {
+                last_out_file = target;
+                last_out_append = (t.kind == TokenKind::RedirectAppend);
                 continue;
             }
-            args.push_back(tok);
+            segments.back().push_back(t.text);
+            segments.back().push_back(target);
+            continue;
         }
-        return 0;
-    };
-
-    std::string first_in_file, last_out_file; bool last_out_append = false;
-    std::vector<std::string> stage_args;
-    // Validate and strip redirections
-    for (size_t si = 0; si < segments.size(); ++si) {
-        bool allow_in = (si == 0);
-        bool allow_out = (si + 1 == segments.size());
-        std::vector<std::string> args;
-        std::string in_file, out_file; bool out_append = false;
-        int rc = parse_redir(segments[si], allow_in, allow_out, args, in_file, out_file, out_append);
-        if (rc != 0) { out_ << "syntax error: missing redirection target" << std::endl; return 2; }
-        if (args.empty()) { out_ << "syntax error: empty command" << std::endl; return 2; }
-        segments[si] = args; // store cleaned args
-        if (allow_in) first_in_file = in_file;
-        if (allow_out) { last_out_file = out_file; last_out_append = out_append; }
+        segments.back().push_back(t.text);
     }
+    if (segments.back().empty()) { out_ << "syntax error: empty command" << std::endl; return 2; }
+
+    // Per-stage usage for `time`; a stage's window also covers the input
+    // redirect (first stage) and the output redirect (last stage).
+    std::vector<StageUsage> usage;
+    UsageSample stage_begin;
+    if (timed) stage_begin = UsageSample::take();
+    auto finish = [&](int rc) {
+        if (timed && !usage.empty()) print_time_report(out_, usage);
+        return rc;
+    };
 
     // Prepare input redirection if any
     std::string in_data;
@@ -255,18 +457,32 @@ int Shell::execute_line_with_env(const std::string& raw_line, Environment& activ
     }
 
     std::string pipe_data;
+    std::vector<std::string> stage_args;
     for (size_t si = 0; si < segments.size(); ++si) {
-        auto& args = segments[si];
+        // Commands receive plain std::string args; this is the only copy
+        // out of the arena per stage.
+        stage_args.assign(segments[si].begin(), segments[si].end());
+        auto& args = stage_args;
         auto* cmd = registry_.find(args[0]);
-        if (!cmd) { out_ << args[0] << ": command not found" << std::endl; return 127; }
+        if (!cmd) { out_ << args[0] << ": command not found" << std::endl; return finish(127); }
 
         bool last = (si + 1 == segments.size());
         std::ostringstream out_buf;
         std::ostream* out_stream = (!last || !last_out_file.empty()) ? static_cast<std::ostream*>(&out_buf) : &out_;
 
-        CommandContext ctx(args, *current_in, *out_stream, vfs_, active_env, cwd_);
-        int rc = cmd->execute(ctx);
-        if (rc != 0) { active_env.set("?", std::to_string(rc)); return rc; }
+        CommandContext ctx(args, *current_in, *out_stream, vfs_, active_env, cwd_, &registry_);
+        ctx.cancel = CancelToken(&interrupted_);
+        if (out_stream == &out_) ctx.sink = OutputSink::of(out_);
+        int rc;
+        {
+            Trace::Span stage_span("stage", args[0]);
+            rc = cmd->execute(ctx);
+        }
+        if (rc != 0) {
+            if (timed) usage.push_back(StageUsage{args[0], stage_begin, UsageSample::take(), -1});
+            active_env.set("?", std::to_string(rc));
+            return finish(rc);
+        }
 
         // Prepare input for next stage
         pipe_data = out_buf.str();
@@ -279,16 +495,42 @@ int Shell::execute_line_with_env(const std::string& raw_line, Environment& activ
                 auto abs_out = vfs_.resolveSecure(cwd_, last_out_file);
                 vfs_.writeFile(abs_out, pipe_data, last_out_append);
             } catch (const std::exception& e) {
-                out_ << "redirect: " << e.what() << std::endl; return 1;
+                out_ << "redirect: " << e.what() << std::endl; return finish(1);
             }
         }
+        if (timed) {
+            auto now = UsageSample::take();
+            usage.push_back(StageUsage{args[0], stage_begin, now, last ? -1 : static_cast<long long>(pipe_data.size())});
+            stage_begin = now;
+        }
     }
     active_env.set("?", "0");
-    return 0;
+    return finish(0);
+}
+
+int Shell::run_command(const std::string& text) {
+    Interrupt::Scope interrupt_scope(interrupted_);
+    Trace::Span span("script", "-c");
+    int rc = execute_script_text(text, /*source_mode*/true, env_, "-c", {});
+    OutputSink::flush(out_);
+    return rc;
+}
+
+int Shell::run_script(const std::filesystem::path& host_path, const std::vector<std::string>& args) {
+    Interrupt::Scope interrupt_scope(interrupted_);
+    Trace::Span span("script", Trace::label(host_path.filename()), Trace::label(host_path));
+    std::ifstream ifs(host_path, std::ios::binary);
+    if (!ifs) { out_ << "cortex: cannot open script: " << host_path.string() << std::endl; return 127; }
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    int rc = execute_script_text(data, /*source_mode*/false, env_, host_path.generic_string(), args);
+    OutputSink::flush(out_);
+    return rc;
 }
 
 int Shell::run() {
+    Interrupt::Scope interrupt_scope(interrupted_);
     // Install Ctrl+C handler(s)
+    Interrupt::Flag* prev_target = s_sigint_target.exchange(&interrupted_);
 #ifdef _WIN32
     SetConsoleCtrlHandler(on_console_ctrl, TRUE);
     // Prevent CRT from terminating the process on SIGINT
@@ -318,6 +560,7 @@ int Shell::run() {
         } catch (const std::exception&) {
             // ignore; will prompt if not found
         }
+        StartupProfile::mark("/etc/username read");
     }
     bool first_run = false;
     // Determine if welcome should be shown (first application run)
@@ -327,6 +570,7 @@ int Shell::run() {
     } catch (const std::exception&) {
         first_run = true;
     }
+    StartupProfile::mark("/etc/welcome_shown read");
 
     if (first_run) {
         out_ << "Cortex v0.1 -- The Core Shell Environment" << std::endl;
@@ -338,6 +582,7 @@ int Shell::run() {
         std::string uname;
         while (true) {
             out_ << "Enter a username: ";
+            OutputSink::flush(out_);
             if (!std::getline(in_, uname)) return 0;
             uname = trim(uname);
             if (!uname.empty()) break;
@@ -372,9 +617,16 @@ int Shell::run() {
     while (true) {
         // reset interrupt flag at the top of loop for fresh command entry
         Interrupt::clear();
+        // The prompt goes out in the same write as the previous command's
+        // buffered output.
         out_ << prompt_user() << "@cortex:" << prompt_path_display() << "$ ";
+        OutputSink::flush(out_);
+        if (StartupProfile::enabled()) {
+            StartupProfile::mark("first prompt");
+            StartupProfile::report(std::cerr);
+        }
         if (!std::getline(in_, line)) {
-            if (s_interrupted.exchange(false)) {
+            if (interrupted_.exchange(false)) {
                 // Clear any partial input and continue without exiting
                 in_.clear();
                 // Drain remainder of the line if buffered
@@ -392,19 +644,19 @@ int Shell::run() {
         }
         if (line == "exit" || line == "quit") break;
         // If interrupted during typing, drop the line and continue
-        if (s_interrupted.exchange(false)) { out_ << "^C" << std::endl; Interrupt::clear(); continue; }
+        if (interrupted_.exchange(false)) { out_ << "^C" << std::endl; Interrupt::clear(); continue; }
 
         // Whole-line comments and shebang are ignored
         {
             auto t = trim(line);
             if (!t.empty() && (t[0] == '#' || (t.size() >= 2 && t[0] == '#' && t[1] == '!'))) {
-                (void)s_interrupted.exchange(false);
+                (void)interrupted_.exchange(false);
                 continue;
             }
         }
         execute_line_with_env(line, env_);
         // If interrupted during command execution, just clear the flags
-        (void)s_interrupted.exchange(false);
+        (void)interrupted_.exchange(false);
         Interrupt::clear();
     }
 
@@ -412,6 +664,7 @@ int Shell::run() {
     // Restore previous handler
     std::signal(SIGINT, prev_handler);
 #endif
+    s_sigint_target.store(prev_target);
     return 0;
 }
 
@@ -428,12 +681,26 @@ std::string Shell::prompt_path_display() const {
 }
 
 int Shell::execute_script_file(const std::filesystem::path& host_path, bool source_mode, Environment& base_env, const std::vector<std::string>& args) {
+    Trace::Span span("script", Trace::label(host_path.filename()), Trace::label(host_path));
     std::string data;
     try {
         data = vfs_.readFile(host_path);
     } catch (const std::exception& e) {
         out_ << "sh: cannot open: " << e.what() << std::endl; return 1;
     }
+    std::string script_name;
+    try {
+        std::error_code ec;
+        auto rel = std::filesystem::relative(host_path, vfs_.root(), ec);
+        script_name = (std::filesystem::path("/") / rel).generic_string();
+    } catch (...) {
+        script_name = host_path.generic_string();
+    }
+    return execute_script_text(data, source_mode, base_env, script_name, args);
+}
+
+int Shell::execute_script_text(const std::string& data, bool source_mode, Environment& base_env,
+                               const std::string& script_name, const std::vector<std::string>& args) {
     std::istringstream is(data);
     std::string line;
     int last_rc = 0;
@@ -446,14 +713,7 @@ int Shell::execute_script_file(const std::filesystem::path& host_path, bool sour
     }
     // Initialize positional parameters and $? for direct script execution
     if (!source_mode) {
-        try {
-            std::error_code ec;
-            auto rel = std::filesystem::relative(host_path, vfs_.root(), ec);
-            auto vpath = (std::filesystem::path("/") / rel).generic_string();
-            env_ptr->set("0", vpath);
-        } catch (...) {
-            env_ptr->set("0", host_path.generic_string());
-        }
+        env_ptr->set("0", script_name);
         env_ptr->set("#", std::to_string(args.size()));
         for (size_t i = 0; i < args.size(); ++i) env_ptr->set(std::to_string(i+1), args[i]);
         if (env_ptr->get("?").empty()) env_ptr->set("?", "0");
@@ -464,7 +724,19 @@ int Shell::execute_script_file(const std::filesystem::path& host_path, bool sour
     auto should_run = [&](){ for (const auto& f : stack) if (!f.executing) return false; return true; };
     auto ancestors_run = [&](){ if (stack.empty()) return true; for (size_t i=0;i+1<stack.size();++i) if (!stack[i].executing) return false; return true; };
 
+    size_t line_no = 0;
+    auto run_line = [&](const std::string& text) {
+        ScriptProfiler::LineScope scope(profiler_, script_name, line_no, text);
+        int rc = execute_line_with_env(text, *env_ptr);
+        // End of a command: what it printed is written now, not with the
+        // rest of the script
+        OutputSink::flush(out_);
+        scope.set_status(rc);
+        return rc;
+    };
+
     while (std::getline(is, line)) {
+        ++line_no;
         auto t = trim(line);
         if (t.empty()) continue;
         if (t[0] == '#') continue; // ignore comments and shebang
@@ -480,7 +752,7 @@ int Shell::execute_script_file(const std::filesystem::path& host_path, bool sour
             if (!cond.empty() && cond.back() == ';') cond.pop_back();
             bool exec_now = false;
             if (should_run()) {
-                int rc = execute_line_with_env(cond, *env_ptr);
+                int rc = run_line(cond);
                 env_ptr->set("?", std::to_string(rc));
                 exec_now = (rc == 0);
                 last_rc = rc;
@@ -505,7 +777,7 @@ int Shell::execute_script_file(const std::filesystem::path& host_path, bool sour
                             break;
                         }
                         if (should_run()) {
-                            int rc2 = execute_line_with_env(seg, *env_ptr);
+                            int rc2 = run_line(seg);
                             env_ptr->set("?", std::to_string(rc2));
                             last_rc = rc2;
                         }
@@ -526,7 +798,7 @@ int Shell::execute_script_file(const std::filesystem::path& host_path, bool sour
                 if (pos_then == std::string::npos) { out_ << "sh: syntax: expected 'then' after elif" << std::endl; return 2; }
                 cond = rtrim(cond.substr(0, pos_then));
                 if (!cond.empty() && cond.back() == ';') cond.pop_back();
-                int rc = execute_line_with_env(cond, *env_ptr);
+                int rc = run_line(cond);
                 env_ptr->set("?", std::to_string(rc));
                 exec_now = (rc == 0);
                 last_rc = rc;
@@ -550,7 +822,7 @@ int Shell::execute_script_file(const std::filesystem::path& host_path, bool sour
         }
 
         if (should_run()) {
-            last_rc = execute_line_with_env(line, *env_ptr);
+            last_rc = run_line(line);
             env_ptr->set("?", std::to_string(last_rc));
         } else {
             // skipped branch
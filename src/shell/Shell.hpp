@@ -3,38 +3,78 @@
 #include <ostream>
 #include <filesystem>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "CommandRegistry.hpp"
+#include "../core/Interrupt.hpp"
 
 class IVfs;
 class Environment;
+class ScriptProfiler;
 
+// One shell session: streams, cwd, environment and interrupt flag. The
+// command registry and the VFS are shared, so any number of sessions may
+// run on separate threads in one process.
 class Shell {
 public:
+    // Uses the process-wide builtin registry.
     Shell(std::istream& in, std::ostream& out, IVfs& vfs, Environment& env);
+    Shell(std::istream& in, std::ostream& out, IVfs& vfs, Environment& env, const CommandRegistry& registry);
     int run();
+    // Non-interactive entry points: no prompt, no username/welcome setup.
+    // Both return the exit status of the last command executed.
+    int run_command(const std::string& text);
+    int run_script(const std::filesystem::path& host_path, const std::vector<std::string>& args);
+    // Request interruption of whatever this session is running. Safe to
+    // call from any thread.
+    void interrupt() { interrupted_.store(true); }
+
+    // Record per-line script statistics into `profiler` (null disables).
+    void set_profiler(ScriptProfiler* profiler) { profiler_ = profiler; }
+
+    // Builtin commands, registered once and shared read-only by all shells.
+    static const CommandRegistry& builtin_registry();
+
+    // Expands a word as typed (Parser::Token::raw): variables and $(...) /
+    // `...` substitutions outside single quotes, then quote removal. With
+    // `pat`, also builds the word's glob pattern there.
+    std::pmr::string expand_word(std::string_view raw, const Environment& env, std::pmr::memory_resource* mr, std::pmr::string* pat = nullptr);
 private:
     std::istream& in_;
     std::ostream& out_;
     IVfs& vfs_;
     Environment& env_;
     std::filesystem::path cwd_; // VFS absolute path (e.g., /home/user)
-    CommandRegistry registry_;
+    const CommandRegistry& registry_;
+    Interrupt::Flag interrupted_{false};
+    ScriptProfiler* profiler_ = nullptr;
+
+    // Initial stack buffer for the per-line arena in execute_line_with_env;
+    // longer lines spill over to the heap in large chunks.
+    static constexpr size_t kLineArenaBytes = 4096;
 
-    void register_builtin_commands();
     int execute_line(const std::string& line);
     int execute_line_with_env(const std::string& line, Environment& env);
     int execute_script_file(const std::filesystem::path& host_path,
                             bool source_mode,
                             Environment& base_env,
                             const std::vector<std::string>& args = {});
+    int execute_script_text(const std::string& data,
+                            bool source_mode,
+                            Environment& base_env,
+                            const std::string& script_name,
+                            const std::vector<std::string>& args);
     bool has_exec_permission(const std::filesystem::path& host_path) const;
-    static std::string expand_vars(const std::string& input, const Environment& env);
+    // Runs `command` as a subshell would (own copy of env, cwd restored
+    // afterwards) and appends its output, minus trailing newlines, to `out`.
+    void capture_output(std::string_view command, const Environment& env, std::pmr::string& out);
     static std::string ltrim(const std::string& s);
     static std::string rtrim(const std::string& s);
     static std::string trim(const std::string& s);
+    static std::string_view trim_view(std::string_view s);
     std::string prompt_path_display() const;
     std::string prompt_user() const;
 };
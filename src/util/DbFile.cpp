@@ -0,0 +1,16 @@
+#include "DbFile.hpp"
+
+#include "../vfs/IVfs.hpp"
+
+namespace fs = std::filesystem;
+
+namespace dbfile {
+
+fs::path host_of(IVfs& vfs, const fs::path& vfs_path) { return vfs.resolveSecure("/", vfs_path); }
+
+TempFiles::~TempFiles() {
+    std::error_code ec;
+    for (const auto& p : paths) fs::remove(p, ec);
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class IVfs;
+
+// Pieces shared by the on-disk databases under /var/lib (locate::, the
+// trigram:: index): little-endian fixed-width integers, LEB128 varints,
+// and cleanup of the temporary files a build writes before renaming the
+// result into place.
+namespace dbfile {
+
+inline void put32(std::string& s, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) s.push_back(static_cast<char>(v >> (8 * i)));
+}
+inline void put64(std::string& s, std::uint64_t v) {
+    for (int i = 0; i < 8; ++i) s.push_back(static_cast<char>(v >> (8 * i)));
+}
+inline std::uint32_t get32(const char* p) {
+    std::uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<std::uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+inline std::uint64_t get64(const char* p) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+inline void put_varint(std::string& s, std::uint64_t v) {
+    while (v >= 0x80) {
+        s.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    s.push_back(static_cast<char>(v));
+}
+// Decodes the varint at `p` and moves `p` past it. Throws
+// std::runtime_error(`damaged`) if it runs into `end` or is too long for T.
+template <class T>
+T get_varint(const char*& p, const char* end, const char* damaged) {
+    T v = 0;
+    for (unsigned shift = 0; shift < sizeof(T) * 8 && p < end; shift += 7) {
+        auto b = static_cast<unsigned char>(*p++);
+        v |= static_cast<T>(b & 0x7F) << shift;
+        if (b < 0x80) return v;
+    }
+    throw std::runtime_error(damaged);
+}
+
+// Host path of an absolute VFS path.
+std::filesystem::path host_of(IVfs& vfs, const std::filesystem::path& vfs_path);
+
+// Removes the files still listed on destruction; a build clears or erases
+// the ones it keeps.
+struct TempFiles {
+    std::vector<std::filesystem::path> paths;
+    ~TempFiles();
+};
+
+}
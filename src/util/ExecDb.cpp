@@ -3,7 +3,9 @@
 #include "../vfs/IVfs.hpp"
 
 #include <cctype>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 namespace execdb {
 
@@ -13,26 +15,77 @@ inline std::filesystem::path root_path(const char* p) {
     return std::filesystem::path(p);
 }
 
+// Parsed databases keyed by host path of /etc/execdb (one per VFS root).
+// An entry is reused while the file's mtime and size are unchanged, so a
+// long-lived process only re-reads the file after it is modified.
+struct CacheEntry {
+    std::filesystem::file_time_type mtime;
+    uintmax_t size = 0;
+    std::unordered_set<std::string> entries;
+};
+
+std::mutex g_cache_mutex;
+std::unordered_map<std::string, CacheEntry> g_cache;
+
+std::unordered_set<std::string> parse(const std::string& data) {
+    std::unordered_set<std::string> result;
+    std::istringstream is(data);
+    std::string line;
+    while (std::getline(is, line)) {
+        size_t start = 0;
+        while (start < line.size() && std::isspace(static_cast<unsigned char>(line[start]))) ++start;
+        size_t end = line.size();
+        while (end > start && std::isspace(static_cast<unsigned char>(line[end - 1]))) --end;
+        if (end > start) result.insert(line.substr(start, end - start));
+    }
+    return result;
+}
+
+// Returns the up-to-date cached entry, or nullptr when the database does
+// not exist. Caller must hold g_cache_mutex.
+const CacheEntry* cached(IVfs& vfs) {
+    auto execdb_host = vfs.resolveSecure(root_path("/"), root_path("/etc/execdb"));
+    auto key = execdb_host.generic_string();
+    StatInfo st;
+    try {
+        st = vfs.stat(execdb_host);
+    } catch (const std::exception&) {
+        g_cache.erase(key);
+        return nullptr;
+    }
+    auto it = g_cache.find(key);
+    if (it != g_cache.end() && it->second.mtime == st.mtime && it->second.size == st.size) {
+        return &it->second;
+    }
+    CacheEntry entry;
+    entry.mtime = st.mtime;
+    entry.size = st.size;
+    entry.entries = parse(vfs.readFile(execdb_host));
+    auto& slot = g_cache[key];
+    slot = std::move(entry);
+    return &slot;
+}
+
 }
 
 std::unordered_set<std::string> load(IVfs& vfs) {
-    std::unordered_set<std::string> result;
     try {
-        auto execdb_host = vfs.resolveSecure(root_path("/"), root_path("/etc/execdb"));
-        auto data = vfs.readFile(execdb_host);
-        std::istringstream is(data);
-        std::string line;
-        while (std::getline(is, line)) {
-            size_t start = 0;
-            while (start < line.size() && std::isspace(static_cast<unsigned char>(line[start]))) ++start;
-            size_t end = line.size();
-            while (end > start && std::isspace(static_cast<unsigned char>(line[end - 1]))) --end;
-            if (end > start) result.insert(line.substr(start, end - start));
-        }
+        std::lock_guard<std::mutex> lock(g_cache_mutex);
+        if (auto entry = cached(vfs)) return entry->entries;
     } catch (const std::exception&) {
         // Missing database is treated as empty.
     }
-    return result;
+    return {};
+}
+
+bool contains(IVfs& vfs, const std::filesystem::path& host_path) {
+    try {
+        std::lock_guard<std::mutex> lock(g_cache_mutex);
+        auto entry = cached(vfs);
+        return entry && entry->entries.count(host_path.generic_string()) != 0;
+    } catch (const std::exception&) {
+        return false;
+    }
 }
 
 void save(IVfs& vfs, const std::unordered_set<std::string>& entries) {
@@ -45,6 +98,11 @@ void save(IVfs& vfs, const std::unordered_set<std::string>& entries) {
     vfs.mkdir(etc_host, true);
     auto execdb_host = vfs.resolveSecure(root_path("/"), root_path("/etc/execdb"));
     vfs.writeFile(execdb_host, os.str(), false);
+
+    // Drop the cached copy; mtime granularity may be too coarse to notice
+    // two writes of the same size in quick succession.
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    g_cache.erase(execdb_host.generic_string());
 }
 
 bool set(IVfs& vfs, const std::filesystem::path& host_path, bool enable) {
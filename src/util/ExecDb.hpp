@@ -11,6 +11,10 @@ namespace execdb {
 // Load the execute-permission database from /etc/execdb inside the VFS.
 std::unordered_set<std::string> load(IVfs& vfs);
 
+// True if the given host path has execute permission. Served from an
+// in-memory copy that is refreshed only when /etc/execdb changes.
+bool contains(IVfs& vfs, const std::filesystem::path& host_path);
+
 // Persist the execute-permission database back to /etc/execdb.
 void save(IVfs& vfs, const std::unordered_set<std::string>& entries);
 
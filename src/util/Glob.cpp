@@ -0,0 +1,146 @@
+#include "Glob.hpp"
+
+namespace glob {
+
+namespace {
+
+// Parses a class starting at pat[i] == '['. On success sets `atom`, moves
+// `i` past the closing ']' and returns true.
+bool parse_class(std::string_view pat, size_t& i, std::bitset<256>& atom) {
+    size_t j = i + 1;
+    bool negate = false;
+    if (j < pat.size() && (pat[j] == '!' || pat[j] == '^')) { negate = true; ++j; }
+    std::bitset<256> set;
+    bool first = true;
+    while (j < pat.size() && (first || pat[j] != ']')) {
+        first = false;
+        unsigned char lo = static_cast<unsigned char>(pat[j]);
+        if (pat[j] == '\\' && j + 1 < pat.size()) lo = static_cast<unsigned char>(pat[++j]);
+        ++j;
+        if (j + 1 < pat.size() && pat[j] == '-' && pat[j + 1] != ']') {
+            unsigned char hi = static_cast<unsigned char>(pat[j + 1]);
+            j += 2;
+            if (hi == '\\' && j < pat.size()) hi = static_cast<unsigned char>(pat[j++]);
+            for (unsigned c = lo; c <= hi; ++c) set.set(c);
+        } else {
+            set.set(lo);
+        }
+    }
+    if (j >= pat.size()) return false; // unterminated: '[' is a literal
+    atom = negate ? ~set : set;
+    i = j + 1;
+    return true;
+}
+
+}
+
+Pattern::Pattern(std::string_view pat) {
+    Piece cur;
+    for (size_t i = 0; i < pat.size(); ) {
+        char c = pat[i];
+        if (c == '*') {
+            wildcards_ = true;
+            if (pieces_.empty() && cur.atoms.empty()) anchored_start_ = false;
+            else if (!cur.atoms.empty()) { pieces_.push_back(std::move(cur)); cur = Piece{}; }
+            while (i < pat.size() && pat[i] == '*') ++i;
+            if (i == pat.size()) anchored_end_ = false;
+            continue;
+        }
+        Atom atom;
+        if (c == '?') { atom.set(); wildcards_ = true; ++i; }
+        else if (c == '[' && parse_class(pat, i, atom)) { wildcards_ = true; }
+        else {
+            if (c == '\\' && i + 1 < pat.size()) ++i;
+            atom.set(static_cast<unsigned char>(pat[i]));
+            ++i;
+        }
+        cur.atoms.push_back(atom);
+    }
+    if (!cur.atoms.empty() || pieces_.empty()) pieces_.push_back(std::move(cur));
+
+    for (auto& p : pieces_) {
+        if (p.atoms.empty() || p.atoms.size() > 64) continue;
+        p.masks.assign(256, 0);
+        for (size_t k = 0; k < p.atoms.size(); ++k)
+            for (unsigned c = 0; c < 256; ++c)
+                if (p.atoms[k].test(c)) p.masks[c] |= std::uint64_t{1} << k;
+    }
+}
+
+bool Pattern::match_at(const Piece& p, std::string_view s, size_t pos) {
+    if (pos + p.atoms.size() > s.size()) return false;
+    for (size_t k = 0; k < p.atoms.size(); ++k)
+        if (!p.atoms[k].test(static_cast<unsigned char>(s[pos + k]))) return false;
+    return true;
+}
+
+size_t Pattern::find(const Piece& p, std::string_view s, size_t from, size_t limit) {
+    const size_t len = p.atoms.size();
+    if (len == 0) return from;
+    if (limit < len || from > limit - len) return std::string_view::npos;
+    if (p.masks.empty()) {
+        for (size_t pos = from; pos + len <= limit; ++pos)
+            if (match_at(p, s, pos)) return pos;
+        return std::string_view::npos;
+    }
+    const std::uint64_t accept = std::uint64_t{1} << (len - 1);
+    std::uint64_t state = 0;
+    for (size_t i = from; i < limit; ++i) {
+        state = ((state << 1) | 1) & p.masks[static_cast<unsigned char>(s[i])];
+        if (state & accept) return i + 1 - len;
+    }
+    return std::string_view::npos;
+}
+
+bool Pattern::match(std::string_view name) const {
+    size_t first = 0, last = pieces_.size();
+    size_t begin = 0, end = name.size();
+
+    if (anchored_start_ && anchored_end_ && pieces_.size() == 1) {
+        return pieces_[0].atoms.size() == name.size() && match_at(pieces_[0], name, 0);
+    }
+    if (anchored_start_) {
+        const auto& p = pieces_[first++];
+        if (!match_at(p, name, 0)) return false;
+        begin = p.atoms.size();
+    }
+    if (anchored_end_ && first < last) {
+        const auto& p = pieces_[--last];
+        if (p.atoms.size() > end - begin) return false;
+        if (!match_at(p, name, end - p.atoms.size())) return false;
+        end -= p.atoms.size();
+    }
+    // Between the anchors each piece takes its leftmost occurrence; a later
+    // match position can never help the pieces that follow it.
+    for (size_t k = first; k < last; ++k) {
+        size_t pos = find(pieces_[k], name, begin, end);
+        if (pos == std::string_view::npos) return false;
+        begin = pos + pieces_[k].atoms.size();
+    }
+    return true;
+}
+
+bool has_wildcards(std::string_view s) {
+    std::bitset<256> atom;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '\\') { ++i; continue; }
+        if (s[i] == '*' || s[i] == '?') return true;
+        if (s[i] == '[') {
+            size_t j = i;
+            if (parse_class(s, j, atom)) return true;
+        }
+    }
+    return false;
+}
+
+std::string unescape(std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '\\' && i + 1 < s.size()) ++i;
+        out += s[i];
+    }
+    return out;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace glob {
+
+// A compiled glob: '*' matches any run of characters, '?' any single
+// character, and [abc], [a-z], [!x] / [^x] a character class. A backslash
+// makes the next character literal. An unterminated '[' is a literal.
+//
+// Matching never backtracks. The pattern is split at '*' into pieces, and
+// each piece is found at its leftmost position with a bit-parallel
+// (shift-and) scan. That is O(name length) per piece, regardless of how
+// many stars the pattern has.
+class Pattern {
+public:
+    Pattern() = default;
+    explicit Pattern(std::string_view pat);
+
+    bool match(std::string_view name) const;
+    // True if the pattern contains an unescaped '*', '?' or class.
+    bool has_wildcards() const { return wildcards_; }
+
+private:
+    // One position of a piece: the set of bytes it accepts.
+    using Atom = std::bitset<256>;
+    struct Piece {
+        std::vector<Atom> atoms;
+        // masks[c] has bit i set when atoms[i] accepts byte c (pieces of
+        // up to 64 atoms); longer pieces use a plain scan.
+        std::vector<std::uint64_t> masks;
+    };
+
+    static bool match_at(const Piece& p, std::string_view s, size_t pos);
+    // Leftmost start >= from where `p` matches within s[0, limit).
+    static size_t find(const Piece& p, std::string_view s, size_t from, size_t limit);
+
+    std::vector<Piece> pieces_;
+    bool anchored_start_ = true; // no leading '*'
+    bool anchored_end_ = true;   // no trailing '*'
+    bool wildcards_ = false;
+};
+
+// True if `s` contains an unescaped '*', '?' or class, as Pattern would
+// compile it: a '[' without its ']' is a literal.
+bool has_wildcards(std::string_view s);
+
+// `s` with backslash escapes removed.
+std::string unescape(std::string_view s);
+
+}
@@ -0,0 +1,121 @@
+#include "Ignore.hpp"
+
+#include "../vfs/IVfs.hpp"
+
+namespace ignore {
+
+namespace {
+
+std::vector<std::string_view> split(std::string_view s) {
+    std::vector<std::string_view> out;
+    size_t start = 0;
+    while (true) {
+        size_t slash = s.find('/', start);
+        out.push_back(s.substr(start, slash == std::string_view::npos ? std::string_view::npos : slash - start));
+        if (slash == std::string_view::npos) return out;
+        start = slash + 1;
+    }
+}
+
+}
+
+Rules::Rules(std::string_view text) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t nl = text.find('\n', pos);
+        if (nl == std::string_view::npos) nl = text.size();
+        std::string_view line = text.substr(pos, nl - pos);
+        pos = nl + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        // Trailing spaces are dropped unless escaped
+        while (!line.empty() && line.back() == ' ' && !(line.size() >= 2 && line[line.size() - 2] == '\\')) line.remove_suffix(1);
+        if (line.empty() || line[0] == '#') continue;
+
+        Rule rule;
+        if (line[0] == '!') {
+            rule.negate = true;
+            line.remove_prefix(1);
+        }
+        if (!line.empty() && line.back() == '/') {
+            rule.dir_only = true;
+            line.remove_suffix(1);
+        }
+        rule.anchored = line.find('/') != std::string_view::npos;
+        if (!line.empty() && line[0] == '/') line.remove_prefix(1);
+        if (line.empty()) continue;
+        for (std::string_view part : split(line)) {
+            if (part.empty()) continue; // "a//b"
+            Part p;
+            p.globstar = part == "**";
+            if (!p.globstar) p.pattern = glob::Pattern(part);
+            rule.parts.push_back(std::move(p));
+        }
+        rules_.push_back(std::move(rule));
+    }
+}
+
+bool Rules::match_parts(const std::vector<Part>& parts, size_t pi, const std::vector<std::string_view>& comps, size_t ci) {
+    for (; pi < parts.size(); ++pi, ++ci) {
+        if (parts[pi].globstar) {
+            // A final "**" matches what is inside, so one component at
+            // least: "foo/**" leaves "foo" itself to later rules
+            if (pi + 1 == parts.size()) return ci < comps.size();
+            for (size_t k = ci; k <= comps.size(); ++k)
+                if (match_parts(parts, pi + 1, comps, k)) return true;
+            return false;
+        }
+        if (ci >= comps.size() || !parts[pi].pattern.match(comps[ci])) return false;
+    }
+    return ci == comps.size();
+}
+
+std::optional<bool> Rules::match(std::string_view rel, bool is_dir) const {
+    const size_t slash = rel.rfind('/');
+    const std::string_view base = slash == std::string_view::npos ? rel : rel.substr(slash + 1);
+    std::vector<std::string_view> comps; // split on first use
+    for (auto it = rules_.rbegin(); it != rules_.rend(); ++it) {
+        const Rule& r = *it;
+        if (r.dir_only && !is_dir) continue;
+        bool hit;
+        if (!r.anchored && r.parts.size() == 1 && !r.parts[0].globstar) {
+            hit = r.parts[0].pattern.match(base);
+        } else {
+            if (comps.empty()) comps = split(rel);
+            if (r.anchored) {
+                hit = match_parts(r.parts, 0, comps, 0);
+            } else {
+                // An unanchored pattern may start at any depth
+                hit = false;
+                for (size_t k = 0; k < comps.size() && !hit; ++k) hit = match_parts(r.parts, 0, comps, k);
+            }
+        }
+        if (hit) return !r.negate;
+    }
+    return std::nullopt;
+}
+
+void Stack::push(IVfs& vfs, const std::filesystem::path& host_dir, size_t prefix) {
+    std::string text;
+    for (const char* name : kFileNames) {
+        std::error_code ec;
+        auto file = host_dir / name;
+        if (!std::filesystem::is_regular_file(file, ec)) continue;
+        try {
+            text += vfs.readFile(file);
+            text += '\n';
+        } catch (const std::exception&) {
+            // unreadable: as if absent
+        }
+    }
+    levels_.push_back({Rules(text), prefix});
+}
+
+bool Stack::ignored(std::string_view rel, bool is_dir) const {
+    for (auto it = levels_.rbegin(); it != levels_.rend(); ++it) {
+        if (it->rules.empty() || it->prefix > rel.size()) continue;
+        if (auto r = it->rules.match(rel.substr(it->prefix), is_dir)) return *r;
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Glob.hpp"
+
+class IVfs;
+
+namespace ignore {
+
+// The rules of one .gitignore-style file. Each line is a glob (see
+// glob::Pattern) matched against paths relative to the file's directory:
+//
+//   # comment         blank lines and lines starting with '#' are skipped
+//   *.log             no '/': matches the name at any depth
+//   build/            a trailing '/' matches directories only
+//   /out, docs/*.tmp  a '/' elsewhere anchors the pattern to this directory
+//   **/cache, a/**/b  '**' matches any number of directories
+//   !keep.log         re-includes what an earlier line excluded
+//
+// '*' and '?' never match '/'. Later lines take precedence over earlier
+// ones.
+class Rules {
+public:
+    Rules() = default;
+    explicit Rules(std::string_view text);
+
+    // True if `rel` ('/'-separated) is excluded, false if a '!' line
+    // re-includes it, nullopt if no line matches.
+    std::optional<bool> match(std::string_view rel, bool is_dir) const;
+    bool empty() const { return rules_.empty(); }
+
+private:
+    struct Part {
+        glob::Pattern pattern;
+        bool globstar = false; // "**"
+    };
+    struct Rule {
+        std::vector<Part> parts;
+        bool negate = false;
+        bool dir_only = false;
+        bool anchored = false;
+    };
+
+    static bool match_parts(const std::vector<Part>& parts, size_t pi, const std::vector<std::string_view>& comps, size_t ci);
+
+    std::vector<Rule> rules_;
+};
+
+// The rules in effect during a depth-first walk: for the walk's root and
+// each directory below it on the way to the current entry, the rules read
+// from its ignore files (kFileNames, later files taking precedence). The
+// deepest directory with a matching rule decides, as in git.
+class Stack {
+public:
+    static constexpr const char* kFileNames[] = {".gitignore", ".cortexignore"};
+
+    // Adds the rules of directory `host_dir`, whose entries are at
+    // walk-relative paths starting at offset `prefix` (0 for the root,
+    // else the directory's own relative path length + 1).
+    void push(IVfs& vfs, const std::filesystem::path& host_dir, size_t prefix);
+    // Drops directories until `depth` remain: for an entry at iterator
+    // depth d, pop_to(d + 1) leaves exactly its ancestors.
+    void pop_to(size_t depth) {
+        if (levels_.size() > depth) levels_.resize(depth);
+    }
+    // True if the walk-relative path `rel` should be skipped (for a
+    // directory, with everything below it).
+    bool ignored(std::string_view rel, bool is_dir) const;
+
+private:
+    struct Level {
+        Rules rules;
+        size_t prefix;
+    };
+    std::vector<Level> levels_;
+};
+
+}
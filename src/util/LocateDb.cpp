@@ -0,0 +1,347 @@
+#include "LocateDb.hpp"
+
+#include "../core/IoStats.hpp"
+#include "../vfs/IVfs.hpp"
+#include "DbFile.hpp"
+#include "Glob.hpp"
+#include "Search.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace locate {
+
+namespace {
+
+// Header: magic, entry count, directory count. Entries follow, each the
+// shared prefix length and suffix length (varints), the suffix, a
+// walk::Type byte and, for a directory, its mtime (ns, 8 bytes).
+constexpr char kMagic[8] = {'C', 'X', 'L', 'O', 'C', 0, 0, 1};
+constexpr size_t kHeaderSize = 24;
+// The builder writes its output in pieces of about this size.
+constexpr size_t kWriteChunk = 1 << 20;
+
+using dbfile::get64;
+using dbfile::host_of;
+using dbfile::put64;
+using dbfile::put_varint;
+
+std::uint64_t get_varint(const char*& p, const char* end) {
+    return dbfile::get_varint<std::uint64_t>(p, end, "locate database is damaged");
+}
+
+bool starts_with(std::string_view s, std::string_view prefix) { return s.substr(0, prefix.size()) == prefix; }
+
+std::string lowercase(std::string_view s) {
+    std::string out(s);
+    for (char& c : out)
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + 32);
+    return out;
+}
+
+// Walks the VFS depth first in tree order, writing each path as it goes.
+// The previous database is read alongside with a cursor that only moves
+// forward, which works because both are in the same order.
+class Builder {
+public:
+    Builder(IVfs& vfs, const CancelToken& cancel) : vfs_(vfs), cancel_(cancel) {}
+
+    std::optional<BuildStats> run(bool incremental) {
+        host_root_ = vfs_.root().generic_string();
+        while (host_root_.size() > 1 && host_root_.back() == '/') host_root_.pop_back();
+        vfs_.mkdir(host_of(vfs_, fs::path(kDbPath).parent_path()), true);
+        const fs::path target = host_of(vfs_, kDbPath);
+        temp_vfs_path_ = std::string(kDbPath) + ".tmp";
+        std::error_code ec;
+        if (incremental && fs::exists(target, ec)) {
+            try {
+                previous_.emplace(target);
+                cursor_.emplace(previous_->reader());
+                advance();
+            } catch (const std::exception&) {
+                cursor_.reset(); // rebuilt from scratch below
+                previous_.reset();
+            }
+        }
+
+        dbfile::TempFiles temp{{fs::path(target).concat(".tmp")}};
+        out_.open(temp.paths[0], std::ios::binary | std::ios::trunc);
+        if (!out_) throw std::runtime_error("cannot write " + temp.paths[0].string());
+        buf_.assign(kHeaderSize, '\0');
+
+        walk::Type type;
+        std::uint64_t size;
+        std::int64_t mtime;
+        if (!walk::stat(host_root_, type, size, mtime)) throw std::runtime_error("cannot read the VFS root");
+        std::optional<std::int64_t> old_mtime;
+        if (cursor_ && !done_ && cursor_->path() == "/" && cursor_->type() == walk::Type::Dir) {
+            old_mtime = cursor_->mtime();
+            advance();
+        }
+        if (!dir("/", mtime, old_mtime)) return std::nullopt;
+
+        flush();
+        std::string header(kMagic, sizeof(kMagic));
+        put64(header, stats_.entries);
+        put64(header, stats_.dirs);
+        out_.seekp(0);
+        out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out_.close();
+        if (!out_) throw std::runtime_error("cannot write " + temp.paths[0].string());
+        cursor_.reset();
+        previous_.reset();
+        fs::rename(temp.paths[0], target);
+        temp.paths.clear();
+        return stats_;
+    }
+
+private:
+    std::string host(const std::string& path) const { return path == "/" ? host_root_ : host_root_ + path; }
+
+    void advance() { done_ = !cursor_->next(); }
+
+    // Writes directory `path` and everything below it. With `old_mtime`,
+    // the previous database has `path` and the cursor is just past it.
+    bool dir(const std::string& path, std::int64_t mtime, std::optional<std::int64_t> old_mtime) {
+        if (cancel_.cancelled()) return false;
+        emit(path, walk::Type::Dir, mtime);
+        const std::string prefix = path == "/" ? path : path + "/";
+
+        if (old_mtime && *old_mtime == mtime) {
+            // Unchanged: its entries follow in the previous database
+            while (!done_ && starts_with(cursor_->path(), prefix)) {
+                if (cursor_->path().find('/', prefix.size()) != std::string::npos) {
+                    advance(); // below a subdirectory that changed
+                    continue;
+                }
+                std::string child = cursor_->path();
+                const walk::Type type = cursor_->type();
+                const std::int64_t child_old = cursor_->mtime();
+                advance();
+                if (!entry(child, type, type == walk::Type::Dir ? std::optional<std::int64_t>(child_old) : std::nullopt)) return false;
+            }
+            return true;
+        }
+
+        ++stats_.dirs_read;
+        std::vector<std::pair<std::string, walk::Type>> children;
+        walk::list(host(path), children); // unreadable: listed as empty
+        std::sort(children.begin(), children.end());
+        for (auto& [name, type] : children) {
+            std::string child = prefix + name;
+            if (child == temp_vfs_path_) continue;
+            std::optional<std::int64_t> child_old;
+            if (cursor_ && type == walk::Type::Dir) {
+                while (!done_ && walk::tree_less(cursor_->path(), child)) advance();
+                if (!done_ && cursor_->path() == child && cursor_->type() == walk::Type::Dir) {
+                    child_old = cursor_->mtime();
+                    advance();
+                }
+            }
+            if (!entry(child, type, child_old)) return false;
+        }
+        return true;
+    }
+
+    bool entry(const std::string& path, walk::Type type, std::optional<std::int64_t> old_mtime) {
+        if (type != walk::Type::Dir) {
+            emit(path, type, 0);
+            return true;
+        }
+        std::uint64_t size;
+        std::int64_t mtime;
+        if (!walk::stat(host(path), type, size, mtime)) return true; // gone meanwhile
+        if (type != walk::Type::Dir) {
+            emit(path, type, 0);
+            return true;
+        }
+        return dir(path, mtime, old_mtime);
+    }
+
+    void emit(const std::string& path, walk::Type type, std::int64_t mtime) {
+        size_t shared = 0;
+        const size_t limit = std::min(path.size(), last_.size());
+        while (shared < limit && path[shared] == last_[shared]) ++shared;
+        put_varint(buf_, shared);
+        put_varint(buf_, path.size() - shared);
+        buf_.append(path, shared, std::string::npos);
+        buf_.push_back(static_cast<char>(type));
+        if (type == walk::Type::Dir) {
+            put64(buf_, static_cast<std::uint64_t>(mtime));
+            ++stats_.dirs;
+        }
+        ++stats_.entries;
+        last_ = path;
+        if (buf_.size() >= kWriteChunk) flush();
+    }
+
+    void flush() {
+        out_.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+        IoStats::add_written(buf_.size());
+        stats_.bytes += buf_.size();
+        buf_.clear();
+    }
+
+    IVfs& vfs_;
+    const CancelToken& cancel_;
+    std::string host_root_;
+    std::string temp_vfs_path_;
+    std::optional<Database> previous_;
+    std::optional<Reader> cursor_;
+    bool done_ = true; // cursor past the previous database's last entry
+    std::ofstream out_;
+    std::string buf_;
+    std::string last_;
+    BuildStats stats_;
+};
+
+}
+
+std::optional<BuildStats> build(IVfs& vfs, bool incremental, const CancelToken& cancel) {
+    if (incremental) {
+        try {
+            return Builder(vfs, cancel).run(true);
+        } catch (const std::exception&) {
+            // a damaged previous database: start over without it
+        }
+    }
+    return Builder(vfs, cancel).run(false);
+}
+
+Reader::Reader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+bool Reader::next() {
+    if (p_ == end_) return false;
+    const std::uint64_t shared = get_varint(p_, end_);
+    const std::uint64_t length = get_varint(p_, end_);
+    if (shared > path_.size() || length >= static_cast<std::uint64_t>(end_ - p_)) throw std::runtime_error("locate database is damaged");
+    path_.resize(shared);
+    path_.append(p_, length);
+    p_ += length;
+    const auto type = static_cast<unsigned char>(*p_++);
+    if (type > static_cast<unsigned char>(walk::Type::Other)) throw std::runtime_error("locate database is damaged");
+    type_ = static_cast<walk::Type>(type);
+    mtime_ = 0;
+    if (type_ == walk::Type::Dir) {
+        if (end_ - p_ < 8) throw std::runtime_error("locate database is damaged");
+        mtime_ = static_cast<std::int64_t>(get64(p_));
+        p_ += 8;
+    }
+    shared_ = shared;
+    return true;
+}
+
+Database::Database(const fs::path& host) {
+#ifndef _WIN32
+    const int fd = ::open(host.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot read " + host.string());
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(kHeaderSize)) {
+        ::close(fd);
+        throw std::runtime_error("not a locate database");
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) throw std::runtime_error("cannot map " + host.string());
+    ::posix_madvise(map, size_, POSIX_MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(map);
+    if (std::memcmp(data_, kMagic, sizeof(kMagic)) != 0) {
+        ::munmap(map, size_);
+        throw std::runtime_error("not a locate database");
+    }
+#else
+    std::ifstream in(host, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot read " + host.string());
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (buffer_.size() < kHeaderSize || std::memcmp(buffer_.data(), kMagic, sizeof(kMagic)) != 0) throw std::runtime_error("not a locate database");
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+    entries_ = get64(data_ + 8);
+    IoStats::add_read(size_);
+}
+
+Database::~Database() {
+#ifndef _WIN32
+    ::munmap(const_cast<char*>(data_), size_);
+#endif
+}
+
+Reader Database::reader() const { return Reader(data_ + kHeaderSize, size_ - kHeaderSize); }
+
+bool Database::search(const Query& q, const CancelToken& cancel, const std::function<bool(std::string_view)>& out) const {
+    struct Matcher {
+        std::optional<search::Finder> finder;
+        std::optional<glob::Pattern> glob;
+        size_t length = 0;
+        // Where the first match in the last path tested ended (npos if
+        // none), and which path that was.
+        size_t last_end = std::string_view::npos;
+        std::uint64_t seen = UINT64_MAX;
+    };
+    std::vector<Matcher> matchers(q.patterns.size());
+    bool fold_subject = false;
+    for (size_t i = 0; i < q.patterns.size(); ++i) {
+        const std::string& p = q.patterns[i];
+        if (glob::has_wildcards(p)) {
+            matchers[i].glob.emplace(q.ignore_case ? lowercase(p) : p);
+            fold_subject = fold_subject || q.ignore_case;
+        } else {
+            matchers[i].finder.emplace(p, q.ignore_case);
+            matchers[i].length = p.size();
+        }
+    }
+
+    Reader r = reader();
+    std::string folded;
+    for (std::uint64_t n = 1; r.next(); ++n) {
+        if ((n & 1023) == 0 && cancel.cancelled()) return false;
+        std::string_view path = r.path();
+        size_t shared = r.shared();
+        if (q.basename) {
+            const size_t slash = path.rfind('/');
+            if (slash + 1 < path.size()) path.remove_prefix(slash + 1);
+            shared = 0;
+        }
+        if (fold_subject) folded = lowercase(path);
+        bool hit = false;
+        for (auto& m : matchers) {
+            if (m.glob) {
+                if (!hit) hit = m.glob->match(fold_subject ? std::string_view(folded) : path);
+                continue;
+            }
+            // A substring: a match that ended within the prefix this path
+            // shares with the previous one is still there, and any new
+            // one must reach past that prefix
+            size_t from = 0;
+            if (m.seen + 1 == n) {
+                if (m.last_end != std::string_view::npos && m.last_end <= shared) {
+                    m.seen = n;
+                    hit = true;
+                    continue;
+                }
+                from = shared >= m.length ? shared - m.length + 1 : 0;
+            }
+            const size_t at = m.finder->find(path, from);
+            m.last_end = at == std::string_view::npos ? at : at + m.length;
+            m.seen = n;
+            hit = hit || at != std::string_view::npos;
+        }
+        if (hit && !out(r.path())) return true;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../core/CancelToken.hpp"
+#include "Walk.hpp"
+
+class IVfs;
+
+namespace locate {
+
+// A database of every path in the VFS, for `locate`.
+//
+// Paths are stored in walk::tree_less order, each front-coded against the
+// one before it: the length of the prefix they share, then the rest. A
+// directory also records its mtime. Consecutive paths share most of their
+// bytes, so the file is a small fraction of the raw path list; lookups
+// memory-map it and decode it front to back.
+//
+// A directory's mtime changes when an entry is added to, removed from or
+// renamed in it, so an incremental build takes the entries of a directory
+// whose mtime is unchanged from the previous database instead of reading
+// it. Subdirectories are still checked, one stat each.
+inline constexpr const char* kDbPath = "/var/lib/locate.db";
+
+struct BuildStats {
+    std::uint64_t entries = 0;  // paths in the new database
+    std::uint64_t dirs = 0;     // of which directories
+    std::uint64_t dirs_read = 0; // directories listed rather than reused
+    std::uint64_t bytes = 0;    // database size
+};
+
+// Writes the database for the whole VFS. With `incremental` and an
+// existing database, unchanged directories are not listed. The new
+// database replaces the old one only when complete. Throws
+// std::runtime_error on failure; returns nullopt when cancelled.
+std::optional<BuildStats> build(IVfs& vfs, bool incremental, const CancelToken& cancel);
+
+struct Query {
+    // A path matches if it matches any pattern. A pattern without
+    // wildcards matches anywhere in the path; one with wildcards (see
+    // glob::Pattern) must match the whole path, '*' crossing '/'.
+    std::vector<std::string> patterns;
+    bool basename = false;    // match the last component only
+    bool ignore_case = false; // ASCII letters
+};
+
+// Decodes a database front to back.
+class Reader {
+public:
+    Reader(const char* data, size_t size);
+
+    // Moves to the next path; false past the last. Throws
+    // std::runtime_error if the data is damaged.
+    bool next();
+    const std::string& path() const { return path_; }
+    walk::Type type() const { return type_; }
+    std::int64_t mtime() const { return mtime_; } // directories only
+    // Bytes path() shares with the path before it.
+    size_t shared() const { return shared_; }
+
+private:
+    const char* p_;
+    const char* end_;
+    std::string path_;
+    walk::Type type_ = walk::Type::Other;
+    std::int64_t mtime_ = 0;
+    size_t shared_ = 0;
+};
+
+// A database mapped into memory.
+class Database {
+public:
+    // Throws std::runtime_error if `host` is missing or not a database.
+    explicit Database(const std::filesystem::path& host);
+    ~Database();
+    Database(const Database&) = delete;
+    Database& operator=(const Database&) = delete;
+
+    Reader reader() const;
+    std::uint64_t entries() const { return entries_; }
+
+    // Calls `out` with each path matching `q`, in stored order, until it
+    // returns false. False if cancelled.
+    bool search(const Query& q, const CancelToken& cancel, const std::function<bool(std::string_view)>& out) const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::uint64_t entries_ = 0;
+#ifdef _WIN32
+    std::string buffer_;
+#endif
+};
+
+}
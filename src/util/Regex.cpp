@@ -0,0 +1,557 @@
+#include "Regex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+namespace regex {
+
+namespace {
+
+constexpr int kMaxRepeat = 255;          // RE_DUP_MAX
+constexpr size_t kMaxNfaStates = 200000; // beyond this the pattern is rejected
+constexpr size_t kMinPrefilter = 2;      // shorter literals hit too often to help
+
+using ByteSet = std::bitset<256>;
+
+struct Node {
+    enum Kind { Set, Empty, Bol, Eol, Concat, Alt, Repeat } kind = Empty;
+    ByteSet set;
+    std::vector<Node> kids;
+    int min = 0, max = 0; // Repeat; max < 0 is unbounded
+};
+
+Node make(Node::Kind kind) {
+    Node n;
+    n.kind = kind;
+    return n;
+}
+
+void add_other_cases(ByteSet& set) {
+    for (int c = 'a'; c <= 'z'; ++c) {
+        if (set[c]) set.set(c - 32);
+        if (set[c - 32]) set.set(c);
+    }
+}
+
+// Recursive descent over ERE syntax. Quantifier characters and '{' with no
+// valid interval are literals where no atom precedes them, as in grep.
+class ReParser {
+public:
+    ReParser(std::string_view pat, bool ignore_case) : pat_(pat), icase_(ignore_case) {}
+
+    Node parse() {
+        Node n = alternation();
+        if (pos_ < pat_.size()) throw std::runtime_error("Unmatched ) or \\)");
+        return n;
+    }
+    bool has_anchor() const { return anchors_; }
+
+private:
+    bool at_end() const { return pos_ >= pat_.size(); }
+    char peek() const { return pat_[pos_]; }
+
+    Node alternation() {
+        Node alt = make(Node::Alt);
+        alt.kids.push_back(concatenation());
+        while (!at_end() && peek() == '|') {
+            ++pos_;
+            alt.kids.push_back(concatenation());
+        }
+        if (alt.kids.size() == 1) return std::move(alt.kids[0]);
+        return alt;
+    }
+
+    Node concatenation() {
+        Node cat = make(Node::Concat);
+        while (!at_end() && peek() != '|' && !(peek() == ')' && depth_ > 0))
+            cat.kids.push_back(repetition());
+        if (cat.kids.size() == 1) return std::move(cat.kids[0]);
+        if (cat.kids.empty()) return make(Node::Empty);
+        return cat;
+    }
+
+    Node repetition() {
+        Node atom_node = atom();
+        while (!at_end()) {
+            int lo, hi;
+            char c = peek();
+            if (c == '*') { lo = 0; hi = -1; ++pos_; }
+            else if (c == '+') { lo = 1; hi = -1; ++pos_; }
+            else if (c == '?') { lo = 0; hi = 1; ++pos_; }
+            else if (c == '{' && interval(lo, hi)) {}
+            else break;
+            Node rep = make(Node::Repeat);
+            rep.min = lo;
+            rep.max = hi;
+            rep.kids.push_back(std::move(atom_node));
+            atom_node = std::move(rep);
+        }
+        return atom_node;
+    }
+
+    // {m}, {m,} or {m,n} at pos_; leaves pos_ alone if it is not one.
+    bool interval(int& lo, int& hi) {
+        size_t i = pos_ + 1;
+        auto number = [&](int& v) {
+            size_t start = i;
+            v = 0;
+            // Every digit is read, saturating past kMaxRepeat, so that any
+            // out-of-range count is rejected below rather than read as text.
+            while (i < pat_.size() && std::isdigit(static_cast<unsigned char>(pat_[i])))
+                v = std::min(v * 10 + (pat_[i++] - '0'), kMaxRepeat + 1);
+            return i > start;
+        };
+        if (!number(lo)) return false;
+        hi = lo;
+        if (i < pat_.size() && pat_[i] == ',') {
+            ++i;
+            if (!number(hi)) hi = -1;
+        }
+        if (i >= pat_.size() || pat_[i] != '}') return false;
+        if (lo > kMaxRepeat || hi > kMaxRepeat || (hi >= 0 && hi < lo))
+            throw std::runtime_error("Invalid content of \\{\\}");
+        pos_ = i + 1;
+        return true;
+    }
+
+    Node literal(unsigned char c) {
+        Node n = make(Node::Set);
+        n.set.set(c);
+        if (icase_) add_other_cases(n.set);
+        return n;
+    }
+
+    Node atom() {
+        char c = pat_[pos_++];
+        switch (c) {
+        case '(': {
+            ++depth_;
+            Node inner = (!at_end() && peek() == ')') ? make(Node::Empty) : alternation();
+            if (at_end() || peek() != ')') throw std::runtime_error("Unmatched ( or \\(");
+            ++pos_;
+            --depth_;
+            return inner;
+        }
+        case '[': return bracket();
+        case '.': {
+            Node n = make(Node::Set);
+            n.set.set();
+            n.set.reset('\n');
+            return n;
+        }
+        case '^': anchors_ = true; return make(Node::Bol);
+        case '$': anchors_ = true; return make(Node::Eol);
+        case '\\': return escape();
+        default: return literal(static_cast<unsigned char>(c));
+        }
+    }
+
+    Node escape() {
+        if (at_end()) throw std::runtime_error("Trailing backslash");
+        char c = pat_[pos_++];
+        Node n = make(Node::Set);
+        switch (c) {
+        case 'w': case 'W':
+            for (int b = 0; b < 128; ++b) if (std::isalnum(b) || b == '_') n.set.set(b);
+            break;
+        case 's': case 'S':
+            for (int b = 0; b < 128; ++b) if (std::isspace(b)) n.set.set(b);
+            break;
+        case 'd': case 'D':
+            for (int b = '0'; b <= '9'; ++b) n.set.set(b);
+            break;
+        case 'b': case 'B': case '<': case '>':
+            throw std::runtime_error(std::string("word boundary \\") + c + " is not supported");
+        default:
+            return literal(static_cast<unsigned char>(c));
+        }
+        if (std::isupper(static_cast<unsigned char>(c))) { n.set.flip(); n.set.reset('\n'); }
+        return n;
+    }
+
+    // After '['. A ']' first in the list is literal, as is a backslash.
+    Node bracket() {
+        Node n = make(Node::Set);
+        bool negate = false;
+        if (!at_end() && peek() == '^') { negate = true; ++pos_; }
+        bool first = true;
+        while (true) {
+            if (at_end()) throw std::runtime_error("Unmatched [, [^, [:, [., or [=");
+            unsigned char c = static_cast<unsigned char>(pat_[pos_]);
+            if (c == ']' && !first) { ++pos_; break; }
+            first = false;
+            if (c == '[' && pos_ + 1 < pat_.size() && pat_[pos_ + 1] == ':') {
+                size_t close = pat_.find(":]", pos_ + 2);
+                if (close == std::string_view::npos) throw std::runtime_error("Unmatched [, [^, [:, [., or [=");
+                named_class(pat_.substr(pos_ + 2, close - pos_ - 2), n.set);
+                pos_ = close + 2;
+                continue;
+            }
+            ++pos_;
+            if (pos_ + 1 < pat_.size() && peek() == '-' && pat_[pos_ + 1] != ']') {
+                unsigned char hi = static_cast<unsigned char>(pat_[pos_ + 1]);
+                if (hi < c) throw std::runtime_error("Invalid range end");
+                for (unsigned b = c; b <= hi; ++b) n.set.set(b);
+                pos_ += 2;
+            } else {
+                n.set.set(c);
+            }
+        }
+        if (icase_) add_other_cases(n.set);
+        if (negate) { n.set.flip(); n.set.reset('\n'); }
+        return n;
+    }
+
+    static void named_class(std::string_view name, ByteSet& set) {
+        int (*pred)(int) = nullptr;
+        if (name == "alpha") pred = [](int c) { return std::isalpha(c); };
+        else if (name == "digit") pred = [](int c) { return std::isdigit(c); };
+        else if (name == "alnum") pred = [](int c) { return std::isalnum(c); };
+        else if (name == "upper") pred = [](int c) { return std::isupper(c); };
+        else if (name == "lower") pred = [](int c) { return std::islower(c); };
+        else if (name == "space") pred = [](int c) { return std::isspace(c); };
+        else if (name == "blank") pred = [](int c) { return (c == ' ' || c == '\t') ? 1 : 0; };
+        else if (name == "punct") pred = [](int c) { return std::ispunct(c); };
+        else if (name == "xdigit") pred = [](int c) { return std::isxdigit(c); };
+        else if (name == "cntrl") pred = [](int c) { return std::iscntrl(c); };
+        else if (name == "print") pred = [](int c) { return std::isprint(c); };
+        else if (name == "graph") pred = [](int c) { return std::isgraph(c); };
+        else throw std::runtime_error("Invalid character class name");
+        for (int c = 0; c < 128; ++c) if (pred(c)) set.set(c);
+    }
+
+    std::string_view pat_;
+    bool icase_;
+    size_t pos_ = 0;
+    int depth_ = 0;
+    bool anchors_ = false;
+};
+
+// What a subexpression says about literals. `exact` means it matches only
+// `text`; `required` is a literal that every match contains.
+struct LiteralInfo {
+    bool exact = false;
+    std::string text;
+    std::string required;
+};
+
+void keep_longer(std::string& best, const std::string& s) {
+    if (s.size() > best.size()) best = s;
+}
+
+// The byte a set stands for if it is one literal (or one letter in both
+// cases when ignoring case).
+bool single_byte(const ByteSet& set, bool icase, char& out) {
+    size_t n = set.count();
+    if (n != 1 && !(icase && n == 2)) return false;
+    int c = 0;
+    while (!set[c]) ++c;
+    if (n == 2 && !(c >= 'A' && c <= 'Z' && set[c + 32])) return false;
+    out = static_cast<char>(c);
+    return true;
+}
+
+LiteralInfo literals(const Node& n, bool icase) {
+    LiteralInfo info;
+    switch (n.kind) {
+    case Node::Set: {
+        char c;
+        if (single_byte(n.set, icase, c)) { info.exact = true; info.text = info.required = std::string(1, c); }
+        break;
+    }
+    case Node::Empty: case Node::Bol: case Node::Eol:
+        info.exact = true; // zero width: transparent inside a concatenation
+        break;
+    case Node::Concat: {
+        std::string run;
+        info.exact = true;
+        for (const auto& k : n.kids) {
+            LiteralInfo sub = literals(k, icase);
+            if (sub.exact) { run += sub.text; continue; }
+            info.exact = false;
+            keep_longer(info.required, run);
+            keep_longer(info.required, sub.required);
+            run.clear();
+        }
+        keep_longer(info.required, run);
+        if (info.exact) info.text = run;
+        break;
+    }
+    case Node::Alt:
+        break;
+    case Node::Repeat: {
+        LiteralInfo sub = literals(n.kids[0], icase);
+        if (n.min >= 1) info.required = sub.required;
+        if (sub.exact && n.min == n.max) {
+            info.exact = true;
+            for (int i = 0; i < n.min; ++i) info.text += sub.text;
+            info.required = info.text;
+        }
+        break;
+    }
+    }
+    return info;
+}
+
+}
+
+// Compiles nodes back to front: each call gets the state to continue at
+// and returns the entry state of the fragment.
+struct Compiler {
+    std::vector<Regex::NfaState>& nfa;
+    std::vector<ByteSet>& sets;
+
+    int add(Regex::NfaState::Op op, int out, int out1 = -1, int set = -1) {
+        if (nfa.size() >= kMaxNfaStates) throw std::runtime_error("regular expression is too large");
+        Regex::NfaState st;
+        st.op = op;
+        st.out = out;
+        st.out1 = out1;
+        st.set = set;
+        nfa.push_back(st);
+        return static_cast<int>(nfa.size() - 1);
+    }
+
+    int compile(const Node& n, int next) {
+        using Op = Regex::NfaState;
+        switch (n.kind) {
+        case Node::Set:
+            sets.push_back(n.set);
+            return add(Op::Byte, next, -1, static_cast<int>(sets.size() - 1));
+        case Node::Empty: return next;
+        case Node::Bol: return add(Op::Bol, next);
+        case Node::Eol: return add(Op::Eol, next);
+        case Node::Concat:
+            for (auto it = n.kids.rbegin(); it != n.kids.rend(); ++it) next = compile(*it, next);
+            return next;
+        case Node::Alt: {
+            int entry = compile(n.kids.back(), next);
+            for (size_t i = n.kids.size() - 1; i-- > 0;) entry = add(Op::Split, compile(n.kids[i], next), entry);
+            return entry;
+        }
+        case Node::Repeat: {
+            const Node& body = n.kids[0];
+            if (n.max < 0) {
+                // Loop: the split prefers another pass through the body
+                int loop = add(Op::Split, -1, next);
+                nfa[static_cast<size_t>(loop)].out = compile(body, loop);
+                next = loop;
+                for (int i = 0; i < n.min; ++i) next = compile(body, next);
+                return n.min > 0 ? next : loop;
+            }
+            for (int i = n.min; i < n.max; ++i) next = add(Op::Split, compile(body, next), next);
+            for (int i = 0; i < n.min; ++i) next = compile(body, next);
+            return next;
+        }
+        }
+        return next;
+    }
+};
+
+Regex::Regex(std::string_view pattern, bool ignore_case)
+    : Regex(std::vector<std::string>{std::string(pattern)}, ignore_case) {}
+
+Regex::Regex(const std::vector<std::string>& patterns, bool ignore_case) {
+    Node root = make(Node::Alt);
+    bool all_exact = true, any_anchor = false;
+    for (const auto& p : patterns) {
+        ReParser parser(p, ignore_case);
+        root.kids.push_back(parser.parse());
+        LiteralInfo lit = literals(root.kids.back(), ignore_case);
+        literals_.push_back(lit.exact ? lit.text : lit.required);
+        all_exact = all_exact && lit.exact;
+        any_anchor = any_anchor || parser.has_anchor();
+    }
+    if (root.kids.size() == 1) {
+        Node only = std::move(root.kids[0]); // not assigned straight from its own child
+        root = std::move(only);
+    }
+
+    Compiler compiler{nfa_, sets_};
+    int match = compiler.add(NfaState::Match, -1);
+    nfa_start_ = compiler.compile(root, match);
+    mark_.assign(nfa_.size(), 0);
+    build_classes();
+
+    // Every match contains one of the per-pattern literals; they are only
+    // worth searching for if each is long enough to be selective.
+    bool usable = !literals_.empty();
+    for (const auto& l : literals_) usable = usable && l.size() >= kMinPrefilter;
+    literal_only_ = all_exact && !any_anchor && usable;
+    if (literals_.size() == 1) {
+        literal_ = literals_[0];
+        literal_only_ = literal_only_ || (all_exact && !any_anchor && !literal_.empty());
+        if (usable || literal_only_) prefilter_.emplace(literal_, ignore_case);
+    } else if (usable) {
+        multi_prefilter_.emplace(literals_, ignore_case);
+    }
+
+    reset_cache();
+}
+
+size_t Regex::candidate(std::string_view data, size_t from) const {
+    return prefilter_ ? prefilter_->find(data, from) : multi_prefilter_->find(data, from);
+}
+
+void Regex::build_classes() {
+    for (const auto& set : sets_) {
+        int remap[512];
+        std::fill(std::begin(remap), std::end(remap), -1);
+        int count = 0;
+        for (int b = 0; b < 256; ++b) {
+            int& id = remap[classes_[b] * 2 + (set[static_cast<size_t>(b)] ? 1 : 0)];
+            if (id < 0) id = count++;
+            classes_[b] = static_cast<std::uint8_t>(id);
+        }
+        class_count_ = count;
+    }
+}
+
+void Regex::reset_cache() const {
+    states_.clear();
+    flags_.clear();
+    next_.clear();
+    index_.clear();
+    // kDead: the empty set, never interned
+    states_.emplace_back();
+    flags_.push_back(kIsDead);
+    next_.insert(next_.end(), static_cast<size_t>(class_count_), kDead);
+    // kStart: interned so that identical sets reached later share it
+    std::vector<int> stack{nfa_start_}, set;
+    closure(stack, /*bol*/true, set);
+    intern(set);
+}
+
+void Regex::closure(std::vector<int>& stack, bool bol, std::vector<int>& out) const {
+    if (++generation_ == 0) { std::fill(mark_.begin(), mark_.end(), 0); generation_ = 1; }
+    out.clear();
+    while (!stack.empty()) {
+        int id = stack.back();
+        stack.pop_back();
+        auto& m = mark_[static_cast<size_t>(id)];
+        if (m == generation_) continue;
+        m = generation_;
+        const NfaState& st = nfa_[static_cast<size_t>(id)];
+        switch (st.op) {
+        case NfaState::Byte: case NfaState::Eol: case NfaState::Match:
+            out.push_back(id);
+            break;
+        case NfaState::Bol:
+            if (bol) stack.push_back(st.out);
+            break;
+        case NfaState::Split:
+            stack.push_back(st.out1);
+            stack.push_back(st.out);
+            break;
+        }
+    }
+    std::sort(out.begin(), out.end());
+}
+
+bool Regex::reaches_match_at_eol(const std::vector<int>& nfa) const {
+    // Past the end of the line only '$' and empty moves are possible
+    std::vector<int> stack;
+    for (int id : nfa)
+        if (nfa_[static_cast<size_t>(id)].op == NfaState::Eol) stack.push_back(nfa_[static_cast<size_t>(id)].out);
+    std::vector<int> seen;
+    while (!stack.empty()) {
+        int id = stack.back();
+        stack.pop_back();
+        if (std::find(seen.begin(), seen.end(), id) != seen.end()) continue;
+        seen.push_back(id);
+        const NfaState& st = nfa_[static_cast<size_t>(id)];
+        if (st.op == NfaState::Match) return true;
+        if (st.op == NfaState::Eol) stack.push_back(st.out);
+        if (st.op == NfaState::Split) { stack.push_back(st.out); stack.push_back(st.out1); }
+    }
+    return false;
+}
+
+int Regex::intern(const std::vector<int>& nfa) const {
+    if (nfa.empty()) return kDead;
+    std::string key(reinterpret_cast<const char*>(nfa.data()), nfa.size() * sizeof(int));
+    auto it = index_.find(key);
+    if (it != index_.end()) return it->second;
+
+    std::uint8_t flags = 0;
+    if (std::any_of(nfa.begin(), nfa.end(), [&](int id) { return nfa_[static_cast<size_t>(id)].op == NfaState::Match; }))
+        flags |= kAccept;
+    if (reaches_match_at_eol(nfa)) flags |= kAcceptEol;
+    int id = static_cast<int>(states_.size());
+    states_.push_back(nfa);
+    flags_.push_back(flags);
+    next_.insert(next_.end(), static_cast<size_t>(class_count_), kUnknown);
+    index_.emplace(std::move(key), id);
+    return id;
+}
+
+int Regex::step(int state, unsigned char c) const {
+    // Every position may start a match, so the start is always re-entered
+    std::vector<int> stack{nfa_start_}, set;
+    for (int id : states_[static_cast<size_t>(state)]) {
+        const NfaState& st = nfa_[static_cast<size_t>(id)];
+        if (st.op == NfaState::Byte && sets_[static_cast<size_t>(st.set)][c]) stack.push_back(st.out);
+    }
+    closure(stack, /*bol*/false, set);
+    if (states_.size() >= kMaxStates) {
+        reset_cache();
+        return intern(set);
+    }
+    int target = intern(set);
+    next_[static_cast<size_t>(state) * static_cast<size_t>(class_count_) + classes_[c]] = target;
+    return target;
+}
+
+bool Regex::run(const char* p, const char* end) const {
+    int s = kStart;
+    if (flags_[static_cast<size_t>(s)] & kAccept) return true;
+    const size_t width = static_cast<size_t>(class_count_);
+    for (; p < end; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        int t = next_[static_cast<size_t>(s) * width + classes_[c]];
+        s = t != kUnknown ? t : step(s, c);
+        std::uint8_t f = flags_[static_cast<size_t>(s)];
+        if (f & kAccept) return true;
+        if (f & kIsDead) return false;
+    }
+    return (flags_[static_cast<size_t>(s)] & kAcceptEol) != 0;
+}
+
+bool Regex::match_line(std::string_view line) const {
+    const bool filtered = prefilter_ || multi_prefilter_;
+    if (literal_only_) return candidate(line, 0) != std::string_view::npos;
+    if (filtered && candidate(line, 0) == std::string_view::npos) return false;
+    return run(line.data(), line.data() + line.size());
+}
+
+size_t Regex::find_line(std::string_view data, size_t from) const {
+    const char* base = data.data();
+    auto line_end = [&](size_t at) {
+        auto* nl = static_cast<const char*>(std::memchr(base + at, '\n', data.size() - at));
+        return nl ? static_cast<size_t>(nl - base) : data.size();
+    };
+    if (prefilter_ || multi_prefilter_) {
+        // Only lines holding a required literal can match
+        size_t pos = from;
+        while (pos < data.size()) {
+            size_t hit = candidate(data, pos);
+            if (hit == std::string_view::npos) return std::string_view::npos;
+            size_t start = hit > pos ? data.rfind('\n', hit - 1) : std::string_view::npos;
+            start = (start == std::string_view::npos || start < pos) ? pos : start + 1;
+            size_t end = line_end(hit);
+            if (literal_only_ || run(base + start, base + end)) return start;
+            pos = end + 1;
+        }
+        return std::string_view::npos;
+    }
+    for (size_t start = from; start < data.size();) {
+        size_t end = line_end(start);
+        if (run(base + start, base + end)) return start;
+        start = end + 1;
+    }
+    return std::string_view::npos;
+}
+
+}
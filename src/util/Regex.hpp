@@ -0,0 +1,115 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Search.hpp"
+
+namespace regex {
+
+struct Compiler;
+
+// A POSIX extended regular expression (grep -E) matched line by line.
+//
+// Supported: literals, '.', bracket expressions ([a-z], [^x], [[:digit:]]),
+// '*', '+', '?', {m}, {m,}, {m,n}, '|', grouping, '^' and '$', and the
+// escapes \w \W \s \S \d \D. Matching is on bytes: '.' and negated classes
+// match a single byte, not a whole UTF-8 character.
+//
+// The pattern is compiled to a Thompson NFA and run as a DFA whose states
+// are built on demand and cached, so every byte is examined once and
+// there is no backtracking. When the cache reaches kMaxStates it is
+// cleared and refilled from the current state.
+//
+// If every match must contain some literal (e.g. "ERROR" in
+// "ERROR [0-9]+ ms"), that literal is searched for with search::Finder
+// first and only lines containing it are run through the DFA. A set of
+// patterns is prefiltered the same way with search::MultiFinder when each
+// pattern has such a literal.
+//
+// The cache is mutable state: one Regex must not be shared between
+// threads, but copies are independent.
+class Regex {
+public:
+    // Throws std::runtime_error on a syntax error.
+    explicit Regex(std::string_view pattern, bool ignore_case = false);
+    // Matches where any of `patterns` does (grep -e A -e B).
+    explicit Regex(const std::vector<std::string>& patterns, bool ignore_case = false);
+
+    // Start of the first line at or after `from` that has a match, or npos.
+    // `from` must be the start of a line. Lines end at '\n'; an empty
+    // remainder after the last '\n' is not a line.
+    size_t find_line(std::string_view data, size_t from = 0) const;
+
+    // True if some part of `line` (no '\n') matches.
+    bool match_line(std::string_view line) const;
+
+    // The literal every match contains ("" if none was found, and always
+    // for a set of patterns).
+    const std::string& required_literal() const { return literal_; }
+    // For each pattern, a literal that all of its matches contain ("" if
+    // none was found).
+    const std::vector<std::string>& required_literals() const { return literals_; }
+
+    static constexpr size_t kMaxStates = 4096;
+
+private:
+    friend struct Compiler;
+
+    struct NfaState {
+        enum Op : std::uint8_t { Byte, Split, Bol, Eol, Match } op = Match;
+        int out = -1, out1 = -1;
+        int set = -1; // index into sets_ for Byte
+    };
+    enum StateFlag : std::uint8_t {
+        kAccept = 1,    // a match has ended
+        kAcceptEol = 2, // a match ends if the line ends here
+        kIsDead = 4,    // no match can start or continue on this line
+    };
+
+    static constexpr int kDead = 0;
+    static constexpr int kStart = 1; // at the start of a line
+    static constexpr int kUnknown = -1;
+
+    void build_classes();
+    void reset_cache() const;
+    // DFA state for a sorted set of NFA states (Byte, Eol and Match).
+    int intern(const std::vector<int>& nfa) const;
+    void closure(std::vector<int>& stack, bool bol, std::vector<int>& out) const;
+    bool reaches_match_at_eol(const std::vector<int>& nfa) const;
+    // Transition that is not in the table yet.
+    int step(int state, unsigned char c) const;
+    // Next prefilter hit at or after `from`; needs one of the prefilters.
+    size_t candidate(std::string_view data, size_t from) const;
+    // Runs one line through the DFA.
+    bool run(const char* p, const char* end) const;
+
+    std::vector<NfaState> nfa_;
+    std::vector<std::bitset<256>> sets_;
+    int nfa_start_ = 0;
+    bool literal_only_ = false; // the patterns are exactly the prefilter's literals
+
+    // Bytes that no pattern set tells apart share a class, which keeps the
+    // transition table narrow.
+    std::uint8_t classes_[256] = {};
+    int class_count_ = 1;
+
+    std::string literal_;
+    std::vector<std::string> literals_;
+    std::optional<search::Finder> prefilter_;
+    std::optional<search::MultiFinder> multi_prefilter_;
+
+    mutable std::vector<std::vector<int>> states_; // NFA set of each DFA state
+    mutable std::vector<std::uint8_t> flags_;      // StateFlag bits per state
+    mutable std::vector<int> next_;                // states_.size() * class_count_
+    mutable std::unordered_map<std::string, int> index_;
+    mutable std::vector<std::uint32_t> mark_;
+    mutable std::uint32_t generation_ = 0;
+};
+
+}
@@ -0,0 +1,389 @@
+#include "Search.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#  include <emmintrin.h>
+#  define SEARCH_SSE2 1
+#  if defined(__GNUC__)
+#    include <immintrin.h>
+#    define SEARCH_AVX2 1
+#  endif
+#endif
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+namespace search {
+
+namespace {
+
+constexpr size_t kBinaryProbeBytes = 32 * 1024;
+
+constexpr bool is_upper(unsigned char c) { return c >= 'A' && c <= 'Z'; }
+constexpr bool is_lower(unsigned char c) { return c >= 'a' && c <= 'z'; }
+
+// ASCII lowercase; every other byte maps to itself.
+struct FoldTable {
+    unsigned char map[256];
+    constexpr FoldTable() : map() {
+        for (unsigned c = 0; c < 256; ++c) map[c] = static_cast<unsigned char>(is_upper(static_cast<unsigned char>(c)) ? c + 32 : c);
+    }
+};
+constexpr FoldTable kFold;
+
+inline char other_case(char c) {
+    auto u = static_cast<unsigned char>(c);
+    if (is_lower(u)) return static_cast<char>(u - 32);
+    if (is_upper(u)) return static_cast<char>(u + 32);
+    return c;
+}
+
+// `s` equals the lowercased `nd` with ASCII case ignored.
+inline bool equal_fold(const char* s, const char* nd, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        if (kFold.map[static_cast<unsigned char>(s[i])] != static_cast<unsigned char>(nd[i])) return false;
+    return true;
+}
+
+inline unsigned lowest_bit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return static_cast<unsigned>(i);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+inline unsigned popcount(unsigned mask) {
+#if defined(_MSC_VER)
+    return __popcnt(mask);
+#else
+    return static_cast<unsigned>(__builtin_popcount(mask));
+#endif
+}
+
+// memchr for the first byte, then a compare. Used for short tails and
+// where no vector unit is available.
+size_t find_scalar(const char* s, size_t len, size_t from, const char* nd, size_t n) {
+    while (from + n <= len) {
+        auto* p = static_cast<const char*>(std::memchr(s + from, nd[0], len - n + 1 - from));
+        if (!p) break;
+        size_t i = static_cast<size_t>(p - s);
+        if (std::memcmp(s + i + 1, nd + 1, n - 1) == 0) return i;
+        from = i + 1;
+    }
+    return std::string_view::npos;
+}
+
+size_t find_scalar_fold(const char* s, size_t len, size_t from, const char* nd, size_t n) {
+    for (; from + n <= len; ++from)
+        if (equal_fold(s + from, nd, n)) return from;
+    return std::string_view::npos;
+}
+
+#if SEARCH_SSE2
+// Needles of two or more bytes. Lane j of a block is a candidate when
+// s[i+j] is the first byte and s[i+j+n-1] the last.
+size_t find_sse2(const char* s, size_t len, size_t from, const char* nd, size_t n) {
+    const __m128i first = _mm_set1_epi8(nd[0]);
+    const __m128i last = _mm_set1_epi8(nd[n - 1]);
+    size_t i = from;
+    for (; i + n - 1 + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + n - 1));
+        unsigned mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+        while (mask) {
+            unsigned j = lowest_bit(mask);
+            if (std::memcmp(s + i + j + 1, nd + 1, n - 2) == 0) return i + j;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(s, len, i, nd, n);
+}
+
+// Folding variant of find_sse2; any needle length. `nd` is lowercased.
+size_t find_sse2_fold(const char* s, size_t len, size_t from, const char* nd, size_t n) {
+    const __m128i first_lo = _mm_set1_epi8(nd[0]), first_up = _mm_set1_epi8(other_case(nd[0]));
+    const __m128i last_lo = _mm_set1_epi8(nd[n - 1]), last_up = _mm_set1_epi8(other_case(nd[n - 1]));
+    size_t i = from;
+    for (; i + n - 1 + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + n - 1));
+        __m128i fa = _mm_or_si128(_mm_cmpeq_epi8(a, first_lo), _mm_cmpeq_epi8(a, first_up));
+        __m128i fb = _mm_or_si128(_mm_cmpeq_epi8(b, last_lo), _mm_cmpeq_epi8(b, last_up));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(fa, fb)));
+        while (mask) {
+            unsigned j = lowest_bit(mask);
+            if (n <= 2 || equal_fold(s + i + j + 1, nd + 1, n - 2)) return i + j;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar_fold(s, len, i, nd, n);
+}
+
+// First offset >= from holding any of `bytes` (1 to 8 of them), or len.
+size_t skip_sse2(const char* s, size_t len, size_t from, const std::string& bytes) {
+    __m128i v[MultiFinder::kMaxSkipBytes];
+    for (size_t k = 0; k < bytes.size(); ++k) v[k] = _mm_set1_epi8(bytes[k]);
+    size_t i = from;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i hit = _mm_cmpeq_epi8(a, v[0]);
+        for (size_t k = 1; k < bytes.size(); ++k) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(a, v[k]));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) return i + lowest_bit(mask);
+    }
+    for (; i < len; ++i)
+        if (bytes.find(s[i]) != std::string::npos) return i;
+    return len;
+}
+
+size_t count_sse2(const char* s, size_t len, char c) {
+    const __m128i v = _mm_set1_epi8(c);
+    size_t i = 0, total = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        total += popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, v))));
+    }
+    for (; i < len; ++i) total += (s[i] == c);
+    return total;
+}
+#endif
+
+#if SEARCH_AVX2
+__attribute__((target("avx2")))
+size_t find_avx2(const char* s, size_t len, size_t from, const char* nd, size_t n) {
+    const __m256i first = _mm256_set1_epi8(nd[0]);
+    const __m256i last = _mm256_set1_epi8(nd[n - 1]);
+    size_t i = from;
+    for (; i + n - 1 + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + n - 1));
+        unsigned mask = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+        while (mask) {
+            unsigned j = lowest_bit(mask);
+            if (std::memcmp(s + i + j + 1, nd + 1, n - 2) == 0) return i + j;
+            mask &= mask - 1;
+        }
+    }
+    return find_sse2(s, len, i, nd, n);
+}
+
+__attribute__((target("avx2")))
+size_t find_avx2_fold(const char* s, size_t len, size_t from, const char* nd, size_t n) {
+    const __m256i first_lo = _mm256_set1_epi8(nd[0]), first_up = _mm256_set1_epi8(other_case(nd[0]));
+    const __m256i last_lo = _mm256_set1_epi8(nd[n - 1]), last_up = _mm256_set1_epi8(other_case(nd[n - 1]));
+    size_t i = from;
+    for (; i + n - 1 + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + n - 1));
+        __m256i fa = _mm256_or_si256(_mm256_cmpeq_epi8(a, first_lo), _mm256_cmpeq_epi8(a, first_up));
+        __m256i fb = _mm256_or_si256(_mm256_cmpeq_epi8(b, last_lo), _mm256_cmpeq_epi8(b, last_up));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(fa, fb)));
+        while (mask) {
+            unsigned j = lowest_bit(mask);
+            if (n <= 2 || equal_fold(s + i + j + 1, nd + 1, n - 2)) return i + j;
+            mask &= mask - 1;
+        }
+    }
+    return find_sse2_fold(s, len, i, nd, n);
+}
+
+__attribute__((target("avx2")))
+size_t skip_avx2(const char* s, size_t len, size_t from, const std::string& bytes) {
+    __m256i v[MultiFinder::kMaxSkipBytes];
+    for (size_t k = 0; k < bytes.size(); ++k) v[k] = _mm256_set1_epi8(bytes[k]);
+    size_t i = from;
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i hit = _mm256_cmpeq_epi8(a, v[0]);
+        for (size_t k = 1; k < bytes.size(); ++k) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(a, v[k]));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) return i + lowest_bit(mask);
+    }
+    return skip_sse2(s, len, i, bytes);
+}
+
+bool has_avx2() {
+    static const bool yes = __builtin_cpu_supports("avx2");
+    return yes;
+}
+#endif
+
+}
+
+Finder::Finder(std::string_view needle, bool ignore_case) : needle_(needle) {
+    if (!ignore_case) return;
+    for (auto& c : needle_) {
+        auto u = static_cast<unsigned char>(c);
+        fold_ = fold_ || is_upper(u) || is_lower(u);
+        c = static_cast<char>(kFold.map[u]);
+    }
+}
+
+size_t Finder::find(std::string_view hay, size_t from) const {
+    const size_t n = needle_.size();
+    if (n == 0) return from <= hay.size() ? from : std::string_view::npos;
+    if (from >= hay.size() || hay.size() - from < n) return std::string_view::npos;
+    if (fold_) {
+#if SEARCH_AVX2
+        if (has_avx2()) return find_avx2_fold(hay.data(), hay.size(), from, needle_.data(), n);
+#endif
+#if SEARCH_SSE2
+        return find_sse2_fold(hay.data(), hay.size(), from, needle_.data(), n);
+#else
+        return find_scalar_fold(hay.data(), hay.size(), from, needle_.data(), n);
+#endif
+    }
+    if (n == 1) {
+        auto* p = static_cast<const char*>(std::memchr(hay.data() + from, needle_[0], hay.size() - from));
+        return p ? static_cast<size_t>(p - hay.data()) : std::string_view::npos;
+    }
+#if SEARCH_AVX2
+    if (has_avx2()) return find_avx2(hay.data(), hay.size(), from, needle_.data(), n);
+#endif
+#if SEARCH_SSE2
+    return find_sse2(hay.data(), hay.size(), from, needle_.data(), n);
+#else
+    return find_scalar(hay.data(), hay.size(), from, needle_.data(), n);
+#endif
+}
+
+MultiFinder::MultiFinder(const std::vector<std::string>& needles, bool ignore_case) {
+    auto fold = [&](unsigned char c) { return ignore_case ? kFold.map[c] : c; };
+
+    // Byte classes: one per distinct (folded) needle byte, plus one shared
+    // by every other byte.
+    bool used[256] = {};
+    for (const auto& n : needles)
+        for (char c : n) used[fold(static_cast<unsigned char>(c))] = true;
+    std::uint16_t folded_class[256] = {};
+    class_count_ = 1;
+    for (unsigned c = 0; c < 256; ++c)
+        if (used[c]) folded_class[c] = static_cast<std::uint16_t>(class_count_++);
+    for (unsigned c = 0; c < 256; ++c) classes_[c] = folded_class[fold(static_cast<unsigned char>(c))];
+
+    // Trie; missing edges are filled in below
+    const size_t w = class_count_;
+    next_.assign(w, -1);
+    out_.assign(1, -1);
+    lengths_.reserve(needles.size());
+    for (size_t i = 0; i < needles.size(); ++i) {
+        const auto& n = needles[i];
+        lengths_.push_back(n.size());
+        if (n.empty()) { if (empty_ < 0) empty_ = static_cast<std::int32_t>(i); continue; }
+        size_t s = 0;
+        for (char c : n) {
+            size_t e = s * w + classes_[static_cast<unsigned char>(c)];
+            if (next_[e] < 0) {
+                next_[e] = static_cast<std::int32_t>(out_.size());
+                next_.insert(next_.end(), w, -1);
+                out_.push_back(-1);
+            }
+            s = static_cast<size_t>(next_[e]);
+        }
+        if (out_[s] < 0) out_[s] = static_cast<std::int32_t>(i);
+    }
+
+    // Breadth-first: failure links, full transitions, and outputs merged
+    // along the failure chain
+    std::vector<std::int32_t> fail(out_.size(), 0);
+    std::deque<size_t> queue;
+    for (size_t c = 0; c < w; ++c) {
+        if (next_[c] < 0) next_[c] = 0;
+        else queue.push_back(static_cast<size_t>(next_[c]));
+    }
+    while (!queue.empty()) {
+        size_t s = queue.front();
+        queue.pop_front();
+        auto f = static_cast<size_t>(fail[s]);
+        if (out_[f] >= 0 && (out_[s] < 0 || out_[f] < out_[s])) out_[s] = out_[f];
+        for (size_t c = 0; c < w; ++c) {
+            std::int32_t& t = next_[s * w + c];
+            std::int32_t via_fail = next_[f * w + c];
+            if (t < 0) { t = via_fail; continue; }
+            fail[static_cast<size_t>(t)] = via_fail;
+            queue.push_back(static_cast<size_t>(t));
+        }
+    }
+
+    // Renumber so that accepting states come last and store transitions
+    // premultiplied by the row width: the scan loop then needs no multiply
+    // and a single compare per byte to notice a match.
+    const size_t states = out_.size();
+    std::vector<std::int32_t> order(states), renamed(states);
+    size_t k = 0;
+    for (size_t st = 0; st < states; ++st) if (out_[st] < 0) order[k++] = static_cast<std::int32_t>(st);
+    first_accepting_ = k * w;
+    for (size_t st = 0; st < states; ++st) if (out_[st] >= 0) order[k++] = static_cast<std::int32_t>(st);
+    for (size_t i = 0; i < states; ++i) renamed[static_cast<size_t>(order[i])] = static_cast<std::int32_t>(i);
+    std::vector<std::int32_t> next(next_.size()), out(states);
+    for (size_t i = 0; i < states; ++i) {
+        auto old_id = static_cast<size_t>(order[i]);
+        out[i] = out_[old_id];
+        for (size_t c = 0; c < w; ++c)
+            next[i * w + c] = renamed[static_cast<size_t>(next_[old_id * w + c])] * static_cast<std::int32_t>(w);
+    }
+    next_.swap(next);
+    out_.swap(out);
+
+    std::string starts;
+    for (unsigned c = 0; c < 256; ++c)
+        if (next_[classes_[c]] != 0) starts.push_back(static_cast<char>(c));
+    if (!starts.empty() && starts.size() <= kMaxSkipBytes) skip_bytes_ = starts;
+}
+
+size_t MultiFinder::skip(const char* s, size_t len, size_t from) const {
+#if SEARCH_AVX2
+    if (has_avx2()) return skip_avx2(s, len, from, skip_bytes_);
+#endif
+#if SEARCH_SSE2
+    return skip_sse2(s, len, from, skip_bytes_);
+#else
+    for (; from < len; ++from)
+        if (skip_bytes_.find(s[from]) != std::string::npos) return from;
+    return len;
+#endif
+}
+
+size_t MultiFinder::find(std::string_view hay, size_t from, size_t& needle) const {
+    if (from > hay.size()) return std::string_view::npos;
+    if (empty_ >= 0) { needle = static_cast<size_t>(empty_); return from; }
+    const char* s = hay.data();
+    const size_t len = hay.size();
+    size_t state = 0; // row offset into next_
+    for (size_t i = from; i < len; ++i) {
+        if (state == 0 && !skip_bytes_.empty()) {
+            i = skip(s, len, i);
+            if (i == len) break;
+        }
+        state = static_cast<size_t>(next_[state + classes_[static_cast<unsigned char>(s[i])]]);
+        if (state >= first_accepting_) {
+            needle = static_cast<size_t>(out_[state / class_count_]);
+            return i + 1 - lengths_[needle];
+        }
+    }
+    return std::string_view::npos;
+}
+
+size_t count(std::string_view s, char c) {
+#if SEARCH_SSE2
+    return count_sse2(s.data(), s.size(), c);
+#else
+    size_t total = 0;
+    for (char x : s) total += (x == c);
+    return total;
+#endif
+}
+
+bool looks_binary(std::string_view data) {
+    return std::memchr(data.data(), '\0', std::min(data.size(), kBinaryProbeBytes)) != nullptr;
+}
+
+}
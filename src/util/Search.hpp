@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace search {
+
+// Finds a fixed byte string in a buffer.
+//
+// The scan compares 16 (SSE2) or 32 (AVX2, picked at runtime) positions
+// at a time against the needle's first and last byte, and only runs a
+// full compare where both agree. On text this rejects nearly every
+// position without touching it twice. Single-byte needles use memchr.
+//
+// With `ignore_case`, ASCII letters match either case: each end test is
+// made against both cases of the byte, and candidates are checked through
+// a folding table, so the haystack is never copied. Bytes above 0x7F
+// (UTF-8 lead and continuation bytes) never fold and are compared
+// exactly, so multi-byte characters match only themselves.
+class Finder {
+public:
+    explicit Finder(std::string_view needle, bool ignore_case = false);
+
+    // Offset of the first occurrence at or after `from`, or npos.
+    size_t find(std::string_view hay, size_t from = 0) const;
+    size_t size() const { return needle_.size(); }
+
+private:
+    std::string needle_; // lowercased when folding
+    bool fold_ = false;  // ignore_case and the needle has a letter
+};
+
+// Finds any of a set of fixed byte strings in one pass (Aho-Corasick).
+//
+// The automaton is a dense transition table over byte classes: bytes that
+// occur in no needle share one class, so hundreds of needles stay a few
+// MB. With `ignore_case`, ASCII letters of either case map to the same
+// class and so cost nothing per byte. When the needles start with at most
+// kMaxSkipBytes distinct bytes, positions where the automaton is at its
+// root are skipped with a vector scan for those bytes.
+class MultiFinder {
+public:
+    static constexpr size_t kMaxSkipBytes = 8;
+
+    explicit MultiFinder(const std::vector<std::string>& needles, bool ignore_case = false);
+
+    // The match that ends first at or after `from` (among those ending at
+    // the same byte, the lowest needle index). Sets `needle` and returns
+    // the match's start offset, or npos if none.
+    size_t find(std::string_view hay, size_t from, size_t& needle) const;
+    size_t find(std::string_view hay, size_t from = 0) const {
+        size_t ignored;
+        return find(hay, from, ignored);
+    }
+
+private:
+    size_t skip(const char* s, size_t len, size_t from) const;
+
+    std::vector<size_t> lengths_;
+    std::uint16_t classes_[256] = {}; // up to 257 classes: 256 bytes and "other"
+    size_t class_count_ = 0;
+    // Row offset (state * class_count_) of the next state, at row offset +
+    // class. Accepting states are numbered last, from first_accepting_ on.
+    std::vector<std::int32_t> next_;
+    std::vector<std::int32_t> out_;  // lowest needle ending in each state, or -1
+    size_t first_accepting_ = 0;     // as a row offset
+    std::int32_t empty_ = -1;        // lowest empty needle, which matches anywhere
+    std::string skip_bytes_;         // start bytes when there are few of them
+};
+
+// Number of `c` bytes in `s`.
+size_t count(std::string_view s, char c);
+
+// True if the start of `data` has a NUL byte, the usual sign that a file
+// is not text.
+bool looks_binary(std::string_view data);
+
+}
@@ -0,0 +1,618 @@
+#include "TrigramIndex.hpp"
+
+#include "../core/IoStats.hpp"
+#include "../vfs/IVfs.hpp"
+#include "DbFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifndef _WIN32
+#  include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace trigram {
+
+namespace {
+
+// Header: magic, id limit, trigram count, the offset and size of the names
+// and the offsets of the file table and trigram directory, then the length
+// of the root. The root's bytes and then the posting lists follow.
+constexpr char kMagic[8] = {'C', 'X', 'T', 'R', 'I', 0, 0, 1};
+constexpr size_t kFixedSize = 48;
+constexpr size_t kHeaderSize = kFixedSize + 4;
+constexpr size_t kFileRecordSize = 32; // name offset, name length, id, mtime, size
+constexpr size_t kDirEntrySize = 20;   // trigram, count, postings offset, postings length
+constexpr std::uint32_t kNoId = 0xFFFFFFFF;
+constexpr unsigned kTrigramBits = 24;
+
+constexpr unsigned char fold(unsigned char c) { return c >= 'A' && c <= 'Z' ? c + 32 : c; }
+
+using dbfile::get32;
+using dbfile::get64;
+using dbfile::host_of;
+using dbfile::put32;
+using dbfile::put64;
+using dbfile::put_varint;
+using dbfile::TempFiles;
+
+std::uint32_t get_varint(const char*& p, const char* end) {
+    return dbfile::get_varint<std::uint32_t>(p, end, "index file is damaged");
+}
+
+void read_exact(std::istream& in, char* buf, size_t n) {
+    if (!in.read(buf, static_cast<std::streamsize>(n))) throw std::runtime_error("index file is truncated");
+    IoStats::add_read(n);
+}
+std::string read_string(std::istream& in, std::uint64_t offset, size_t n) {
+    std::string s(n, '\0');
+    in.seekg(static_cast<std::streamoff>(offset));
+    read_exact(in, s.data(), n);
+    return s;
+}
+
+std::uint64_t fnv1a(std::string_view s) {
+    std::uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : s) h = (h ^ c) * 1099511628211ull;
+    return h;
+}
+
+// A file's mtime (ns since the epoch) and size, with one stat() where
+// there is one: std::filesystem stats once for each.
+bool stamp_of(const fs::path& p, std::int64_t& mtime, std::uint64_t& size) {
+#ifndef _WIN32
+    struct stat st;
+    if (::stat(p.c_str(), &st) != 0) return false;
+    mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    size = static_cast<std::uint64_t>(st.st_size);
+    return true;
+#else
+    std::error_code ec;
+    auto t = fs::last_write_time(p, ec);
+    if (!ec) size = fs::file_size(p, ec);
+    mtime = static_cast<std::int64_t>(t.time_since_epoch().count());
+    return !ec;
+#endif
+}
+
+// The distinct trigrams of one file. A 2 MB bitmap over all 2^24
+// trigrams deduplicates them; only the bits that were set are cleared
+// again, so small files stay cheap.
+class TrigramSet {
+public:
+    TrigramSet() : bits_((1u << 24) / 64, 0) {}
+
+    const std::vector<std::uint32_t>& collect(std::string_view data) {
+        for (std::uint32_t t : list_) bits_[t >> 6] = 0;
+        list_.clear();
+        if (data.size() < 3) return list_;
+        auto p = reinterpret_cast<const unsigned char*>(data.data());
+        std::uint32_t t = static_cast<std::uint32_t>(fold(p[0])) << 8 | fold(p[1]);
+        for (size_t i = 2; i < data.size(); ++i) {
+            t = ((t << 8) | fold(p[i])) & 0xFFFFFF;
+            std::uint64_t& word = bits_[t >> 6];
+            std::uint64_t bit = std::uint64_t{1} << (t & 63);
+            if (word & bit) continue;
+            word |= bit;
+            list_.push_back(t);
+        }
+        return list_;
+    }
+
+private:
+    std::vector<std::uint64_t> bits_;
+    std::vector<std::uint32_t> list_;
+};
+
+std::vector<std::uint32_t> trigrams_of(std::string_view literal) {
+    std::vector<std::uint32_t> out;
+    for (size_t i = 0; i + 3 <= literal.size(); ++i) {
+        auto p = reinterpret_cast<const unsigned char*>(literal.data() + i);
+        out.push_back(static_cast<std::uint32_t>(fold(p[0])) << 16 | static_cast<std::uint32_t>(fold(p[1])) << 8 | fold(p[2]));
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+// The postings of one trigram from one source. `rest` holds the deltas
+// after `first`, so runs over increasing ids join by re-coding one delta.
+struct Run {
+    std::uint32_t trigram = 0;
+    std::uint32_t count = 0;
+    std::uint32_t first = 0;
+    std::uint32_t last = 0;
+    std::string rest;
+};
+
+void write_run(std::ostream& out, const Run& r) {
+    std::string head;
+    put32(head, r.trigram);
+    put32(head, r.count);
+    put32(head, r.first);
+    put32(head, r.last);
+    put32(head, static_cast<std::uint32_t>(r.rest.size()));
+    out.write(head.data(), static_cast<std::streamsize>(head.size()));
+    out.write(r.rest.data(), static_cast<std::streamsize>(r.rest.size()));
+}
+
+// Runs in trigram order, read back from somewhere.
+class RunSource {
+public:
+    virtual ~RunSource() = default;
+    // False at the end.
+    virtual bool next(Run& r) = 0;
+};
+
+// A segment written by Builder::spill().
+class SegmentSource : public RunSource {
+public:
+    explicit SegmentSource(const fs::path& path) : in_(path, std::ios::binary) {
+        if (!in_) throw std::runtime_error("cannot read " + path.string());
+    }
+    bool next(Run& r) override {
+        char head[20];
+        if (!in_.read(head, sizeof(head))) return false;
+        r.trigram = get32(head);
+        r.count = get32(head + 4);
+        r.first = get32(head + 8);
+        r.last = get32(head + 12);
+        r.rest.resize(get32(head + 16));
+        if (!in_.read(r.rest.data(), static_cast<std::streamsize>(r.rest.size()))) throw std::runtime_error("index segment is truncated");
+        return true;
+    }
+
+private:
+    std::ifstream in_;
+};
+
+// The previous index, with ids renumbered through `remap` and files that
+// are gone or changed (kNoId) dropped.
+class PreviousSource : public RunSource {
+public:
+    PreviousSource(const fs::path& path, std::uint64_t directory_offset, std::uint32_t trigrams, std::vector<std::uint32_t> remap)
+        : dir_(path, std::ios::binary), postings_(path, std::ios::binary), left_(trigrams), remap_(std::move(remap)) {
+        if (!dir_ || !postings_) throw std::runtime_error("cannot read " + path.string());
+        dir_.seekg(static_cast<std::streamoff>(directory_offset));
+    }
+    bool next(Run& r) override {
+        while (left_ > 0) {
+            --left_;
+            char entry[kDirEntrySize];
+            read_exact(dir_, entry, sizeof(entry));
+            // Lists are stored in directory order, so after the first they
+            // are read in sequence
+            buf_.resize(get32(entry + 16));
+            if (!started_) postings_.seekg(static_cast<std::streamoff>(get64(entry + 8)));
+            started_ = true;
+            read_exact(postings_, buf_.data(), buf_.size());
+            r.trigram = get32(entry);
+            r.count = 0;
+            r.rest.clear();
+            const char* p = buf_.data();
+            const char* end = p + buf_.size();
+            std::uint32_t id = 0;
+            for (std::uint32_t n = get32(entry + 4); n > 0; --n) {
+                id += get_varint(p, end);
+                if (id >= remap_.size()) throw std::runtime_error("index file is damaged");
+                std::uint32_t mapped = remap_[id];
+                if (mapped == kNoId) continue;
+                if (r.count++ == 0) r.first = mapped;
+                else put_varint(r.rest, mapped - r.last);
+                r.last = mapped;
+            }
+            if (r.count > 0) return true;
+        }
+        return false;
+    }
+
+private:
+    std::ifstream dir_, postings_;
+    std::uint32_t left_;
+    bool started_ = false;
+    std::vector<std::uint32_t> remap_;
+    std::string buf_;
+};
+
+}
+
+fs::path index_path(const std::string& dir) {
+    static const char* digits = "0123456789abcdef";
+    std::uint64_t h = fnv1a(dir);
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; --i, h >>= 4) name[static_cast<size_t>(i)] = digits[h & 15];
+    return fs::path(kIndexDir) / (name + ".tri");
+}
+
+// Walks the directory, reads what changed and merges the postings of the
+// previous index, the spilled segments and the last in-memory batch into
+// a new index file.
+class Builder {
+public:
+    Builder(IVfs& vfs, const std::string& dir, const CancelToken& cancel, size_t spill_bytes)
+        : vfs_(vfs), dir_(dir), cancel_(cancel), spill_bytes_(spill_bytes) {}
+
+    std::optional<BuildStats> run(bool incremental) {
+        fs::path host = host_of(vfs_, dir_);
+        std::error_code ec;
+        if (!fs::is_directory(host, ec)) throw std::runtime_error(dir_ + ": not a directory");
+        vfs_.mkdir(host_of(vfs_, kIndexDir), true);
+        target_ = host_of(vfs_, index_path(dir_));
+        temp_.paths.push_back(fs::path(target_).concat(".tmp"));
+
+        std::optional<Index> previous;
+        if (incremental && fs::exists(target_, ec)) {
+            try {
+                previous.emplace(Index());
+                previous->load(target_);
+                if (previous->root_ != dir_) previous.reset();
+            } catch (const std::exception&) {
+                previous.reset(); // rebuilt from scratch below
+            }
+        }
+
+        // Walk first: unchanged files must get the low ids, in their
+        // previous order, before any new file is numbered.
+        struct Entry {
+            fs::path host;
+            std::string rel;
+            std::int64_t mtime;
+            std::uint64_t size;
+        };
+        std::vector<Entry> fresh;
+        std::vector<std::uint32_t> remap(previous ? previous->id_limit_ : 0, kNoId);
+        std::vector<std::pair<std::uint32_t, Entry>> reused; // by previous id
+        const fs::path store = host_of(vfs_, kIndexDir);
+        const size_t host_len = host.native().size() + (host.native().back() == '/' ? 0 : 1);
+        for (fs::recursive_directory_iterator it(host, fs::directory_options::skip_permission_denied, ec), end; it != end; it.increment(ec)) {
+            if (ec) break;
+            if (cancel_.cancelled()) return std::nullopt;
+            if (it->path() == store) { it.disable_recursion_pending(); continue; }
+            std::error_code fec;
+            if (!it->is_regular_file(fec)) continue;
+            Entry e{it->path(), fs::path(it->path().native().substr(host_len)).generic_string(), 0, 0};
+            if (!stamp_of(e.host, e.mtime, e.size)) continue;
+            if (previous) {
+                const Index::FileRecord* f = previous->find(e.rel);
+                if (f && f->mtime == e.mtime && f->size == e.size) {
+                    reused.emplace_back(f->id, std::move(e));
+                    continue;
+                }
+            }
+            fresh.push_back(std::move(e));
+        }
+
+        std::sort(reused.begin(), reused.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        std::uint32_t next_id = 0;
+        for (auto& [old_id, e] : reused) {
+            remap[old_id] = next_id;
+            add_file(e.rel, next_id++, e.mtime, e.size);
+        }
+        stats_.reused = reused.size();
+
+        // A file of n bytes has at most n distinct trigrams
+        std::uint64_t fresh_bytes = 0;
+        for (const auto& e : fresh) fresh_bytes += e.size;
+        size_slots(fresh_bytes);
+
+        TrigramSet set;
+        for (auto& e : fresh) {
+            if (cancel_.cancelled()) return std::nullopt;
+            std::string data;
+            try { data = vfs_.readFile(e.host); }
+            catch (const std::exception&) { continue; } // not indexed: always searched
+            stats_.bytes += data.size();
+            std::uint32_t id = next_id++;
+            add_file(e.rel, id, e.mtime, e.size);
+            for (std::uint32_t t : set.collect(data)) add_posting(t, id);
+            if (pending_bytes_ > spill_bytes_) spill();
+        }
+        spill();
+
+        std::vector<std::unique_ptr<RunSource>> sources; // in id order
+        if (previous && !reused.empty())
+            sources.push_back(std::make_unique<PreviousSource>(target_, previous->directory_offset_, previous->trigram_count_, std::move(remap)));
+        for (size_t i = 1; i < temp_.paths.size(); ++i) sources.push_back(std::make_unique<SegmentSource>(temp_.paths[i]));
+        stats_.segments = temp_.paths.size() - 1;
+        previous.reset();
+        if (!write(sources, next_id)) return std::nullopt;
+        // PreviousSource reads target_; it must be closed before the
+        // rename, which Windows refuses for an open file
+        sources.clear();
+        fs::rename(temp_.paths[0], target_);
+        temp_.paths.erase(temp_.paths.begin());
+        stats_.files = files_.size();
+        return stats_;
+    }
+
+private:
+    struct FileInfo {
+        std::string rel;
+        std::uint32_t id;
+        std::int64_t mtime;
+        std::uint64_t size;
+    };
+
+    void add_file(const std::string& rel, std::uint32_t id, std::int64_t mtime, std::uint64_t size) {
+        files_.push_back({rel, id, mtime, size});
+    }
+
+    // Sizes slots_ to keep it at most half full for `input_bytes` of
+    // files, up to one slot per trigram.
+    void size_slots(std::uint64_t input_bytes) {
+        slot_bits_ = 6;
+        while (slot_bits_ < kTrigramBits && (std::uint64_t{1} << (slot_bits_ - 1)) < input_bytes) ++slot_bits_;
+        slots_.assign(std::size_t{1} << slot_bits_, kNoId);
+    }
+
+    // The slot for trigram `t`: its own at full size, else found by
+    // linear probing from a multiplicative hash.
+    std::uint32_t& slot_of(std::uint32_t t) {
+        if (slot_bits_ == kTrigramBits) return slots_[t];
+        const size_t mask = slots_.size() - 1;
+        size_t i = static_cast<std::uint32_t>(t * 0x9E3779B1u) >> (32 - slot_bits_);
+        while (slots_[i] != kNoId && pending_[slots_[i]].trigram != t) i = (i + 1) & mask;
+        return slots_[i];
+    }
+
+    void add_posting(std::uint32_t t, std::uint32_t id) {
+        // Files that grew since the walk can outrun the estimate
+        if (pending_.size() * 2 >= slots_.size()) spill();
+        std::uint32_t& slot = slot_of(t);
+        if (slot == kNoId) {
+            slot = static_cast<std::uint32_t>(pending_.size());
+            pending_.emplace_back();
+            pending_bytes_ += sizeof(Run);
+        }
+        Run& r = pending_[slot];
+        if (r.count++ == 0) {
+            r.trigram = t;
+            r.first = id;
+        } else {
+            size_t before = r.rest.capacity();
+            put_varint(r.rest, id - r.last);
+            pending_bytes_ += r.rest.capacity() - before;
+        }
+        r.last = id;
+    }
+
+    // Writes the pending runs, sorted by trigram, to a new segment file.
+    void spill() {
+        if (pending_.empty()) return;
+        fs::path seg = fs::path(target_).concat(".seg" + std::to_string(temp_.paths.size()));
+        temp_.paths.push_back(seg);
+        std::ofstream out(seg, std::ios::binary | std::ios::trunc);
+        std::sort(pending_.begin(), pending_.end(), [](const Run& a, const Run& b) { return a.trigram < b.trigram; });
+        for (const Run& r : pending_) write_run(out, r);
+        if (!out.flush()) throw std::runtime_error("cannot write " + seg.string());
+        std::fill(slots_.begin(), slots_.end(), kNoId);
+        pending_.clear();
+        pending_bytes_ = 0;
+    }
+
+    bool write(std::vector<std::unique_ptr<RunSource>>& sources, std::uint32_t id_limit) {
+        std::ofstream out(temp_.paths[0], std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("cannot write " + temp_.paths[0].string());
+        std::string header(kFixedSize, '\0');
+        put32(header, static_cast<std::uint32_t>(dir_.size()));
+        header += dir_;
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        std::uint64_t offset = header.size();
+
+        // K-way merge: every trigram's list is the concatenation of the
+        // sources' runs in source order, which is increasing id order.
+        std::vector<Run> heads(sources.size());
+        std::vector<bool> live(sources.size());
+        for (size_t i = 0; i < sources.size(); ++i) live[i] = sources[i]->next(heads[i]);
+        std::string directory, list;
+        std::uint32_t trigrams = 0;
+        while (true) {
+            if (cancel_.cancelled()) return false;
+            std::uint32_t t = kNoId;
+            for (size_t i = 0; i < sources.size(); ++i)
+                if (live[i]) t = std::min(t, heads[i].trigram);
+            if (t == kNoId) break;
+            list.clear();
+            std::uint32_t count = 0, last = 0;
+            for (size_t i = 0; i < sources.size(); ++i) {
+                if (!live[i] || heads[i].trigram != t) continue;
+                const Run& r = heads[i];
+                put_varint(list, r.first - last);
+                list += r.rest;
+                count += r.count;
+                last = r.last;
+                live[i] = sources[i]->next(heads[i]);
+            }
+            out.write(list.data(), static_cast<std::streamsize>(list.size()));
+            put32(directory, t);
+            put32(directory, count);
+            put64(directory, offset);
+            put32(directory, static_cast<std::uint32_t>(list.size()));
+            offset += list.size();
+            ++trigrams;
+        }
+
+        std::sort(files_.begin(), files_.end(), [](const FileInfo& a, const FileInfo& b) { return a.rel < b.rel; });
+        std::string names, table;
+        for (const auto& f : files_) {
+            put64(table, names.size());
+            put32(table, static_cast<std::uint32_t>(f.rel.size()));
+            put32(table, f.id);
+            put64(table, static_cast<std::uint64_t>(f.mtime));
+            put64(table, f.size);
+            names += f.rel;
+        }
+        const std::uint64_t names_offset = offset;
+        const std::uint64_t files_offset = names_offset + names.size();
+        const std::uint64_t directory_offset = files_offset + table.size();
+        out.write(names.data(), static_cast<std::streamsize>(names.size()));
+        out.write(table.data(), static_cast<std::streamsize>(table.size()));
+        out.write(directory.data(), static_cast<std::streamsize>(directory.size()));
+
+        std::string fixed(kMagic, sizeof(kMagic));
+        put32(fixed, id_limit);
+        put32(fixed, trigrams);
+        put64(fixed, names_offset);
+        put64(fixed, names.size());
+        put64(fixed, files_offset);
+        put64(fixed, directory_offset);
+        out.seekp(0);
+        out.write(fixed.data(), static_cast<std::streamsize>(fixed.size()));
+        if (!out.flush()) throw std::runtime_error("cannot write " + temp_.paths[0].string());
+        IoStats::add_written(directory_offset + directory.size());
+        stats_.trigrams = trigrams;
+        return true;
+    }
+
+    IVfs& vfs_;
+    const std::string dir_;
+    const CancelToken& cancel_;
+    const size_t spill_bytes_;
+    fs::path target_;
+    TempFiles temp_; // the new index, then the segments in order
+    std::vector<FileInfo> files_;
+    // Runs being collected, and where each trigram's run is in pending_
+    // (kNoId if it has none yet). Every distinct trigram of every file
+    // costs one lookup, so when the input could hold most trigrams the
+    // table is flat, 2^24 slots indexed by trigram; for less input it is
+    // a hash table sized from it rather than 64 MB.
+    std::vector<Run> pending_;
+    std::vector<std::uint32_t> slots_;
+    unsigned slot_bits_ = 0;
+    size_t pending_bytes_ = 0;
+    BuildStats stats_;
+};
+
+std::optional<BuildStats> build(IVfs& vfs, const std::string& dir, bool incremental, const CancelToken& cancel,
+                                size_t spill_bytes) {
+    return Builder(vfs, dir, cancel, spill_bytes).run(incremental);
+}
+
+bool drop(IVfs& vfs, const std::string& dir) {
+    fs::path host = host_of(vfs, index_path(dir));
+    std::error_code ec;
+    if (!fs::exists(host, ec)) return false;
+    vfs.remove(host, false);
+    return true;
+}
+
+void Index::load(const fs::path& host) {
+    std::ifstream in(host, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot read " + host.string());
+    char header[kHeaderSize];
+    read_exact(in, header, sizeof(header));
+    if (std::memcmp(header, kMagic, sizeof(kMagic)) != 0) throw std::runtime_error("not an index file");
+    id_limit_ = get32(header + 8);
+    trigram_count_ = get32(header + 12);
+    const std::uint64_t names_offset = get64(header + 16);
+    const std::uint64_t names_size = get64(header + 24);
+    const std::uint64_t files_offset = get64(header + 32);
+    directory_offset_ = get64(header + 40);
+    if (files_offset > directory_offset_) throw std::runtime_error("index file is damaged");
+    root_ = read_string(in, kHeaderSize, get32(header + kFixedSize));
+    names_ = read_string(in, names_offset, names_size);
+    const size_t count = (directory_offset_ - files_offset) / kFileRecordSize;
+    std::string table = read_string(in, files_offset, count * kFileRecordSize);
+    files_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const char* p = table.data() + i * kFileRecordSize;
+        FileRecord& f = files_[i];
+        f.name_offset = get64(p);
+        f.name_length = get32(p + 8);
+        f.id = get32(p + 12);
+        f.mtime = static_cast<std::int64_t>(get64(p + 16));
+        f.size = get64(p + 24);
+        if (f.name_offset + f.name_length > names_.size() || f.id >= id_limit_) throw std::runtime_error("index file is damaged");
+    }
+    host_ = host;
+}
+
+std::optional<Index> Index::covering(IVfs& vfs, const std::string& dir) {
+    for (fs::path d = dir;; d = d.parent_path()) {
+        try {
+            fs::path host = host_of(vfs, index_path(d.generic_string()));
+            std::error_code ec;
+            if (fs::exists(host, ec)) {
+                Index index;
+                index.load(host);
+                if (index.root_ == d.generic_string()) return index;
+            }
+        } catch (const std::exception&) {
+            // unreadable or damaged: look further up
+        }
+        if (d == d.root_path()) return std::nullopt;
+    }
+}
+
+const Index::FileRecord* Index::find(std::string_view rel) const {
+    auto it = std::lower_bound(files_.begin(), files_.end(), rel, [this](const FileRecord& f, std::string_view key) { return name(f) < key; });
+    return it != files_.end() && name(*it) == rel ? &*it : nullptr;
+}
+
+std::vector<std::uint32_t> Index::postings(std::istream& in, std::uint32_t t) const {
+    // Binary search of the on-disk directory
+    std::uint32_t lo = 0, hi = trigram_count_;
+    char entry[kDirEntrySize];
+    while (lo < hi) {
+        std::uint32_t mid = lo + (hi - lo) / 2;
+        in.seekg(static_cast<std::streamoff>(directory_offset_ + std::uint64_t{mid} * kDirEntrySize));
+        read_exact(in, entry, sizeof(entry));
+        std::uint32_t found = get32(entry);
+        if (found == t) {
+            std::string list = read_string(in, get64(entry + 8), get32(entry + 16));
+            std::vector<std::uint32_t> ids(get32(entry + 4));
+            const char* p = list.data();
+            std::uint32_t id = 0;
+            for (auto& out : ids) out = id += get_varint(p, list.data() + list.size());
+            return ids;
+        }
+        if (found < t) lo = mid + 1;
+        else hi = mid;
+    }
+    return {};
+}
+
+void Index::narrow(const std::vector<std::string>& literals) {
+    std::ifstream in(host_, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot read " + host_.string());
+    candidate_.assign(id_limit_, false);
+    // Patterns from -f often share trigrams
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> cache;
+    for (const auto& literal : literals) {
+        std::vector<std::uint32_t> ids;
+        bool first = true;
+        for (std::uint32_t t : trigrams_of(literal)) {
+            auto it = cache.find(t);
+            if (it == cache.end()) it = cache.emplace(t, postings(in, t)).first;
+            if (first) {
+                ids = it->second;
+                first = false;
+            } else {
+                std::vector<std::uint32_t> both;
+                std::set_intersection(ids.begin(), ids.end(), it->second.begin(), it->second.end(), std::back_inserter(both));
+                ids.swap(both);
+            }
+            if (ids.empty()) break;
+        }
+        for (std::uint32_t id : ids)
+            if (id < id_limit_) candidate_[id] = true;
+    }
+}
+
+bool Index::excludes(std::string_view rel, const fs::path& host) const {
+    if (candidate_.empty()) return false;
+    const FileRecord* f = find(rel);
+    if (!f || candidate_[f->id]) return false;
+    // Only files about to be skipped need checking for changes
+    std::int64_t mtime;
+    std::uint64_t size;
+    return stamp_of(host, mtime, size) && f->mtime == mtime && f->size == size;
+}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../core/CancelToken.hpp"
+
+class IVfs;
+
+namespace trigram {
+
+// A persistent index of which files under a directory contain which
+// trigrams (3-byte sequences, ASCII letters folded to lowercase), used by
+// grep -r to skip files that cannot contain a pattern.
+//
+// One index file per indexed directory lives in kIndexDir inside the VFS.
+// It holds the indexed files, sorted by path with their mtime and size at
+// indexing time, and one posting list of file ids per trigram, sorted by
+// trigram. Lists are delta-coded varints; all integers are little-endian.
+// Lookups seek to the lists they need, so a query reads a few KB of
+// postings however large the index is.
+//
+// The index only ever rules files out. A file whose mtime or size differs
+// from the index, or that the index does not know, is searched as usual,
+// so results stay exact while the index goes stale.
+inline constexpr const char* kIndexDir = "/var/lib/index";
+
+// Shortest literal the index can say anything about.
+inline constexpr size_t kMinLiteral = 3;
+
+// While building, postings held in memory beyond this many bytes are
+// written out to a temporary segment; the segments are merged at the end.
+inline constexpr size_t kSpillBytes = size_t{256} << 20;
+
+struct BuildStats {
+    size_t files = 0;        // files in the new index
+    size_t reused = 0;       // unchanged since the previous index, not read
+    std::uint64_t bytes = 0; // content read
+    size_t trigrams = 0;     // distinct trigrams
+    size_t segments = 0;     // spilled segments merged into the index
+};
+
+// VFS path of the index for VFS directory `dir` (absolute, normalized).
+std::filesystem::path index_path(const std::string& dir);
+
+// Indexes every regular file under `dir` (a VFS path). With `incremental`
+// and an existing index, files whose mtime and size are unchanged keep
+// their postings without being read. The new index replaces the old one
+// only when complete. `spill_bytes` bounds the memory held for postings
+// (see kSpillBytes). Throws std::runtime_error on failure; returns nullopt
+// when cancelled.
+std::optional<BuildStats> build(IVfs& vfs, const std::string& dir, bool incremental, const CancelToken& cancel,
+                                size_t spill_bytes = kSpillBytes);
+
+// Removes the index for `dir`. False if there was none.
+bool drop(IVfs& vfs, const std::string& dir);
+
+class Index {
+public:
+    // The index of `dir` or of its closest indexed ancestor, or nullopt.
+    // A damaged index file is ignored.
+    static std::optional<Index> covering(IVfs& vfs, const std::string& dir);
+
+    // VFS path of the indexed directory.
+    const std::string& root() const { return root_; }
+
+    // Narrows the index to files that may contain at least one of
+    // `literals`, each at least kMinLiteral bytes. Matching is ASCII
+    // case-insensitive, so the result also holds for grep -i.
+    void narrow(const std::vector<std::string>& literals);
+
+    // True if the file at `rel` (relative to root(), '/'-separated; `host`
+    // on the host) was ruled out by narrow() and its mtime and size are
+    // still those in the index.
+    bool excludes(std::string_view rel, const std::filesystem::path& host) const;
+
+private:
+    friend class Builder;
+
+    struct FileRecord {
+        std::uint64_t name_offset;
+        std::uint32_t name_length;
+        std::uint32_t id;
+        std::int64_t mtime;
+        std::uint64_t size;
+    };
+
+    Index() = default;
+    // Reads the header and file table; throws std::runtime_error.
+    void load(const std::filesystem::path& host);
+    const FileRecord* find(std::string_view rel) const;
+    std::string_view name(const FileRecord& f) const { return std::string_view(names_).substr(f.name_offset, f.name_length); }
+    // Sorted ids of the files holding trigram `t`.
+    std::vector<std::uint32_t> postings(std::istream& in, std::uint32_t t) const;
+
+    std::filesystem::path host_;
+    std::string root_;
+    std::string names_;
+    std::vector<FileRecord> files_; // by name
+    std::uint32_t trigram_count_ = 0;
+    std::uint64_t directory_offset_ = 0;
+    std::uint32_t id_limit_ = 0;    // one past the highest file id
+    std::vector<bool> candidate_; // by id; empty until narrow()
+};
+
+}
@@ -0,0 +1,297 @@
+#include "Walk.hpp"
+
+#include "../core/IoStats.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#ifndef _WIN32
+#  include <dirent.h>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif
+
+namespace walk {
+
+namespace {
+
+#ifndef _WIN32
+Type type_of_mode(unsigned mode) {
+    if (S_ISREG(mode)) return Type::File;
+    if (S_ISDIR(mode)) return Type::Dir;
+    if (S_ISLNK(mode)) return Type::Symlink;
+    return Type::Other;
+}
+
+// Fills type, size and mtime of `name` in the directory `dir_fd` without
+// following a symlink. One statx where available, asking only for what
+// Entry holds so network file systems can skip the rest.
+bool stat_at(int dir_fd, const char* name, Entry& e) {
+#if defined(STATX_BASIC_STATS)
+    struct statx stx;
+    if (::statx(dir_fd, name, AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_SIZE | STATX_MTIME, &stx) != 0) return false;
+    e.type = type_of_mode(stx.stx_mode);
+    e.size = stx.stx_size;
+    e.mtime = static_cast<std::int64_t>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+#else
+    struct stat st;
+    if (::fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return false;
+    e.type = type_of_mode(st.st_mode);
+    e.size = static_cast<std::uint64_t>(st.st_size);
+    e.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+// The type readdir reports for `de`, with a stat where it reports none.
+// False if that stat fails.
+bool type_of_dirent(int dir_fd, const dirent* de, Entry& e, bool need_stat) {
+    switch (de->d_type) {
+    case DT_REG: e.type = Type::File; break;
+    case DT_DIR: e.type = Type::Dir; break;
+    case DT_LNK: e.type = Type::Symlink; break;
+    case DT_UNKNOWN: need_stat = true; break;
+    default: e.type = Type::Other; break;
+    }
+    return !need_stat || stat_at(dir_fd, de->d_name, e);
+}
+
+bool is_dot_or_dotdot(const char* name) {
+    return name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0));
+}
+#endif
+
+}
+
+bool tree_less(std::string_view a, std::string_view b) {
+    const size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] == b[i]) continue;
+        if (a[i] == '/') return true;
+        if (b[i] == '/') return false;
+        return static_cast<unsigned char>(a[i]) < static_cast<unsigned char>(b[i]);
+    }
+    return a.size() < b.size();
+}
+
+bool list(const std::string& dir, std::vector<std::pair<std::string, Type>>& out) {
+#ifndef _WIN32
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) return false;
+    IoStats::add_listed(1);
+    const int fd = ::dirfd(d);
+    while (const dirent* de = ::readdir(d)) {
+        if (is_dot_or_dotdot(de->d_name)) continue;
+        Entry e{{}, {}, Type::Other, 0};
+        if (type_of_dirent(fd, de, e, false)) out.emplace_back(de->d_name, e.type);
+    }
+    ::closedir(d);
+    return true;
+#else
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+    if (ec) return false;
+    IoStats::add_listed(1);
+    for (; !ec && it != end; it.increment(ec)) {
+        std::error_code tec;
+        Type t = it->is_symlink(tec) ? Type::Symlink : it->is_directory(tec) ? Type::Dir : it->is_regular_file(tec) ? Type::File : Type::Other;
+        out.emplace_back(it->path().filename().string(), t);
+    }
+    return true;
+#endif
+}
+
+bool stat(const std::string& path, Type& type, std::uint64_t& size, std::int64_t& mtime) {
+#ifndef _WIN32
+    Entry e{{}, {}, Type::Other, 0};
+    if (!stat_at(AT_FDCWD, path.c_str(), e)) return false;
+    type = e.type;
+    size = e.size;
+    mtime = e.mtime;
+    return true;
+#else
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    auto st = fs::symlink_status(path, ec);
+    if (ec) return false;
+    type = fs::is_symlink(st) ? Type::Symlink : fs::is_directory(st) ? Type::Dir : fs::is_regular_file(st) ? Type::File : Type::Other;
+    size = type == Type::File ? fs::file_size(path, ec) : 0;
+    mtime = static_cast<std::int64_t>(fs::last_write_time(path, ec).time_since_epoch().count());
+    return true;
+#endif
+}
+
+Walker::Walker(Options opt, Visit visit) : opt_(opt), visit_(std::move(visit)) {
+    if (opt_.threads == 0) opt_.threads = 1;
+}
+
+Walker::~Walker() {
+    stop();
+    for (auto& t : threads_) t.join();
+}
+
+bool Walker::start(const std::string& root) {
+    std::string_view name = root;
+    while (name.size() > 1 && name.back() == '/') name.remove_suffix(1);
+    if (size_t slash = name.rfind('/'); slash != std::string_view::npos && slash + 1 < name.size()) name.remove_prefix(slash + 1);
+    Entry e{root, name, Type::Other, 0};
+#ifndef _WIN32
+    // The root is followed if it is a link, as the user named it
+    struct stat st;
+    if (::stat(root.c_str(), &st) != 0) return false;
+    e.type = type_of_mode(st.st_mode);
+    if (opt_.stat) {
+        e.size = static_cast<std::uint64_t>(st.st_size);
+        e.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+#else
+    std::error_code ec;
+    auto status = std::filesystem::status(root, ec);
+    if (ec) return false;
+    e.type = std::filesystem::is_directory(status) ? Type::Dir : std::filesystem::is_regular_file(status) ? Type::File : Type::Other;
+    if (opt_.stat && e.type == Type::File) {
+        e.size = std::filesystem::file_size(root, ec);
+        e.mtime = static_cast<std::int64_t>(std::filesystem::last_write_time(root, ec).time_since_epoch().count());
+    }
+#endif
+    if (!visit_(e, 0) || e.type != Type::Dir || opt_.max_depth < 1) return true;
+
+    for (unsigned i = 0; i < opt_.threads; ++i) queues_.push_back(std::make_unique<Queue>());
+    std::vector<Dir> first{{root, 0}};
+    push(0, first);
+    threads_.reserve(opt_.threads);
+    try {
+        for (unsigned i = 0; i < opt_.threads; ++i) threads_.emplace_back([this, i] { work(i); });
+    } catch (const std::system_error&) {
+        // Fewer workers only means less stealing; with none there is no walk
+        if (threads_.empty()) throw;
+    }
+    return true;
+}
+
+bool Walker::wait_for(std::chrono::milliseconds period) {
+    std::unique_lock<std::mutex> lock(idle_mu_);
+    return idle_cv_.wait_for(lock, period, [this] { return pending_ == 0 || stop_; }) && pending_ == 0;
+}
+
+void Walker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(idle_mu_);
+        stop_ = true;
+    }
+    idle_cv_.notify_all();
+}
+
+void Walker::work(unsigned w) {
+    while (!stop_) {
+        Dir d;
+        if (pop(w, d) || steal(w, d)) {
+            read_dir(d, w);
+            finished_one();
+            continue;
+        }
+        // Nothing to take: sleep until some worker queues a directory or
+        // the walk ends. sleepers_ is raised before queued_ is checked and
+        // push() raises queued_ before checking sleepers_, so one of the
+        // two always sees the other. A waker may find the deque not yet
+        // filled; it just goes round again.
+        std::unique_lock<std::mutex> lock(idle_mu_);
+        ++sleepers_;
+        idle_cv_.wait(lock, [this] { return stop_ || pending_ == 0 || queued_ > 0; });
+        --sleepers_;
+        if (pending_ == 0) return;
+    }
+}
+
+bool Walker::pop(unsigned w, Dir& d) {
+    Queue& q = *queues_[w];
+    std::lock_guard<std::mutex> lock(q.mu);
+    if (q.dirs.empty()) return false;
+    d = std::move(q.dirs.back());
+    q.dirs.pop_back();
+    --queued_;
+    return true;
+}
+
+bool Walker::steal(unsigned w, Dir& d) {
+    for (size_t k = 1; k < queues_.size(); ++k) {
+        Queue& q = *queues_[(w + k) % queues_.size()];
+        std::lock_guard<std::mutex> lock(q.mu);
+        if (q.dirs.empty()) continue;
+        d = std::move(q.dirs.front());
+        q.dirs.pop_front();
+        --queued_;
+        return true;
+    }
+    return false;
+}
+
+void Walker::push(unsigned w, std::vector<Dir>& dirs) {
+    if (dirs.empty()) return;
+    pending_ += dirs.size();
+    queued_ += dirs.size();
+    {
+        Queue& q = *queues_[w];
+        std::lock_guard<std::mutex> lock(q.mu);
+        for (auto& d : dirs) q.dirs.push_back(std::move(d));
+    }
+    if (sleepers_ > 0) {
+        std::lock_guard<std::mutex> lock(idle_mu_);
+        idle_cv_.notify_all();
+    }
+}
+
+void Walker::finished_one() {
+    if (--pending_ == 0) {
+        std::lock_guard<std::mutex> lock(idle_mu_);
+        idle_cv_.notify_all();
+    }
+}
+
+void Walker::read_dir(const Dir& d, unsigned w) {
+    std::vector<Dir> subdirs;
+    std::string path = d.path;
+    if (path.empty() || path.back() != '/') path += '/';
+    const size_t base = path.size();
+    const int depth = d.depth + 1;
+#ifndef _WIN32
+    DIR* dir = ::opendir(d.path.c_str());
+    if (!dir) return;
+    listed_.fetch_add(1, std::memory_order_relaxed);
+    const int fd = ::dirfd(dir);
+    while (const dirent* de = ::readdir(dir)) {
+        if (stop_) break;
+        if (is_dot_or_dotdot(de->d_name)) continue;
+        path.resize(base);
+        path += de->d_name;
+        Entry e{path, std::string_view(path).substr(base), Type::Other, depth};
+        if (!type_of_dirent(fd, de, e, opt_.stat)) continue;
+        if (visit_(e, w) && e.type == Type::Dir && depth < opt_.max_depth) subdirs.push_back({path, depth});
+    }
+    ::closedir(dir);
+#else
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    listed_.fetch_add(1, std::memory_order_relaxed);
+    for (fs::directory_iterator it(d.path, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec)) {
+        if (stop_) break;
+        path.resize(base);
+        path += it->path().filename().string();
+        Entry e{path, std::string_view(path).substr(base), Type::Other, depth};
+        std::error_code tec;
+        if (it->is_symlink(tec)) e.type = Type::Symlink;
+        else if (it->is_directory(tec)) e.type = Type::Dir;
+        else if (it->is_regular_file(tec)) e.type = Type::File;
+        if (opt_.stat && e.type == Type::File) {
+            e.size = it->file_size(tec);
+            e.mtime = static_cast<std::int64_t>(it->last_write_time(tec).time_since_epoch().count());
+        }
+        if (visit_(e, w) && e.type == Type::Dir && depth < opt_.max_depth) subdirs.push_back({path, depth});
+    }
+#endif
+    push(w, subdirs);
+}
+
+}
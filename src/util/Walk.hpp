@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace walk {
+
+enum class Type : std::uint8_t { File, Dir, Symlink, Other };
+
+struct Entry {
+    std::string_view path; // host path
+    std::string_view name; // last component of path
+    Type type;
+    int depth;             // 0 for the root, 1 for its entries, ...
+    // Filled only with Options::stat, otherwise 0.
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0; // ns since the epoch
+};
+
+struct Options {
+    unsigned threads = 1;
+    int max_depth = INT_MAX; // entries deeper than this are not visited
+    bool stat = false;       // fill Entry::size and mtime (one stat per entry)
+};
+
+// Orders paths as a depth-first walk visiting names in byte order would:
+// '/' sorts before every other byte, so "a/b" comes right after "a" and
+// before "a-b".
+bool tree_less(std::string_view a, std::string_view b);
+
+// The entries of host directory `dir` except "." and "..", typed as
+// Walker types them. False if `dir` cannot be read.
+bool list(const std::string& dir, std::vector<std::pair<std::string, Type>>& out);
+
+// Type, size and mtime of host path `path`, not following a symlink.
+// False if it does not exist.
+bool stat(const std::string& path, Type& type, std::uint64_t& size, std::int64_t& mtime);
+
+// Called for every entry, on worker threads and concurrently; `worker`
+// (below Options::threads) lets callers keep per-thread state. Returning
+// false for a directory skips its contents.
+using Visit = std::function<bool(const Entry& e, unsigned worker)>;
+
+// Walks a host directory tree on a pool of threads.
+//
+// Each worker owns a deque of directories still to be read. It takes the
+// newest one from the back of its own deque (depth first, so the working
+// set stays small) and, when that is empty, steals the oldest from the
+// front of another's, which tends to be a large unexplored subtree.
+//
+// Entry types come from readdir's d_type, so listing a directory costs no
+// stat per entry; a stat is made only where the file system does not
+// report the type, or for every entry with Options::stat (one statx on
+// Linux, asking for just size and mtime). Symbolic links are reported as
+// such and never followed, except for the root.
+//
+// Unreadable directories are skipped silently.
+class Walker {
+public:
+    Walker(Options opt, Visit visit);
+    // Stops the walk if it is still running and joins the workers.
+    ~Walker();
+
+    // Visits `root` (depth 0) and, if it is a directory, starts the
+    // workers on it. Returns at once; false if `root` does not exist.
+    // Throws std::system_error if not one worker thread can be started.
+    bool start(const std::string& root);
+    // Waits up to `period`; true once the walk is complete.
+    bool wait_for(std::chrono::milliseconds period);
+    // Ends the walk early. Workers finish the directory they are reading.
+    void stop();
+    // Directories read so far. The workers' IoStats are their own, so a
+    // caller that reports I/O adds this to its thread's.
+    std::uint64_t dirs_listed() const { return listed_.load(std::memory_order_relaxed); }
+
+private:
+    struct Dir {
+        std::string path;
+        int depth;
+    };
+    struct Queue {
+        std::mutex mu;
+        std::deque<Dir> dirs;
+    };
+
+    void work(unsigned w);
+    bool pop(unsigned w, Dir& d);
+    bool steal(unsigned w, Dir& d);
+    void read_dir(const Dir& d, unsigned w);
+    void push(unsigned w, std::vector<Dir>& dirs);
+    void finished_one();
+
+    Options opt_;
+    const Visit visit_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    // Directories queued or being read; the walk is over at zero.
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> queued_{0}; // of which sitting in a deque
+    std::atomic<unsigned> sleepers_{0};
+    std::atomic<bool> stop_{false};
+    std::atomic<std::uint64_t> listed_{0};
+    std::mutex idle_mu_;
+    std::condition_variable idle_cv_;
+};
+
+}
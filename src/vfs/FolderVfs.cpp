@@ -1,4 +1,5 @@
 #include "FolderVfs.hpp"
+#include "../core/IoStats.hpp"
 #include <fstream>
 #include <system_error>
 
@@ -11,9 +12,18 @@ static path canonical_or_weak(const path& p) {
     return r;
 }
 
-FolderVfs::FolderVfs(std::filesystem::path root) : root_(std::move(root)) {
-    std::error_code ec;
-    create_directories(root_, ec);
+FolderVfs::FolderVfs(std::filesystem::path root) : root_(std::move(root)) {}
+
+void FolderVfs::ensure_root() const {
+    std::call_once(root_once_, [this]{
+        std::error_code ec;
+        create_directories(root_, ec);
+    });
+}
+
+const std::filesystem::path& FolderVfs::canonical_root() const {
+    std::call_once(canon_once_, [this]{ root_can_ = canonical_or_weak(root_); });
+    return root_can_;
 }
 
 std::filesystem::path FolderVfs::resolveSecure(const std::filesystem::path& cwd,
@@ -23,10 +33,9 @@ std::filesystem::path FolderVfs::resolveSecure(const std::filesystem::path& cwd,
     // map to host path
     path host = canonical_or_weak(root_ / vfs_path.relative_path());
     // ensure within root
-    auto root_can = canonical_or_weak(root_);
-    auto host_str = host.native();
-    auto root_str = root_can.native();
-    if (host_str.size() < root_str.size() || host_str.substr(0, root_str.size()) != root_str) {
+    const auto& host_str = host.native();
+    const auto& root_str = canonical_root().native();
+    if (host_str.size() < root_str.size() || host_str.compare(0, root_str.size(), root_str) != 0) {
         throw std::runtime_error("security: path escapes VFS root");
     }
     return host;
@@ -42,10 +51,12 @@ std::vector<DirEntry> FolderVfs::list(const std::filesystem::path& path) const {
         e.size = e.is_dir ? 0 : file_size(de.path(), ec);
         out.push_back(std::move(e));
     }
+    IoStats::add_listed(1);
     return out;
 }
 
 void FolderVfs::touch(const std::filesystem::path& path) {
+    ensure_root();
     std::error_code ec;
     if (!exists(path)) {
         create_directories(path.parent_path(), ec);
@@ -59,6 +70,7 @@ void FolderVfs::touch(const std::filesystem::path& path) {
 }
 
 void FolderVfs::mkdir(const std::filesystem::path& path, bool recursive) {
+    ensure_root();
     std::error_code ec;
     if (recursive) {
         create_directories(path, ec);
@@ -82,15 +94,17 @@ void FolderVfs::remove(const std::filesystem::path& path, bool recursive) {
 }
 
 void FolderVfs::copy(const std::filesystem::path& src, const std::filesystem::path& dst, bool recursive) {
+    ensure_root();
     std::error_code ec;
     copy_options opts = copy_options::none;
-    if (recursive) opts = copy_options::recursive | copy_options::overwrite_existing;
+    if (recursive) opts = copy_options::recursive | copy_options::overwrite_existing | copy_options::copy_symlinks;
     else opts = copy_options::overwrite_existing;
     std::filesystem::copy(src, dst, opts, ec);
     if (ec) throw std::runtime_error("cp: " + ec.message());
 }
 
 void FolderVfs::move(const std::filesystem::path& src, const std::filesystem::path& dst) {
+    ensure_root();
     std::error_code ec;
     std::filesystem::rename(src, dst, ec);
     if (ec) throw std::runtime_error("mv: " + ec.message());
@@ -108,16 +122,43 @@ StatInfo FolderVfs::stat(const std::filesystem::path& path) const {
 }
 
 std::string FolderVfs::readFile(const std::filesystem::path& path) const {
-    std::ifstream ifs(path, std::ios::binary);
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
     if (!ifs) throw std::runtime_error("cat: cannot open file");
-    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    // One read of the reported size; files that report none (or grow while
+    // being read) are drained through the stream buffer.
+    std::string data;
+    auto size = ifs.tellg();
+    if (size > 0) {
+        data.resize(static_cast<size_t>(size));
+        ifs.seekg(0);
+        ifs.read(data.data(), size);
+        data.resize(static_cast<size_t>(ifs.gcount()));
+        ifs.clear();
+    }
+    data.append(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    IoStats::add_read(data.size());
     return data;
 }
 
+size_t FolderVfs::readFileRange(const std::filesystem::path& path, std::uint64_t offset, size_t count, std::string& out) const {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) throw std::runtime_error("cat: cannot open file");
+    if (offset > 0) ifs.seekg(static_cast<std::streamoff>(offset));
+    const size_t old = out.size();
+    out.resize(old + count);
+    ifs.read(out.data() + old, static_cast<std::streamsize>(count));
+    const auto got = static_cast<size_t>(ifs.gcount());
+    out.resize(old + got);
+    IoStats::add_read(got);
+    return got;
+}
+
 void FolderVfs::writeFile(const std::filesystem::path& path, const std::string& data, bool append) {
+    ensure_root();
     std::error_code ec;
     create_directories(path.parent_path(), ec);
     std::ofstream ofs(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
     if (!ofs) throw std::runtime_error("write: cannot open file");
     ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+    IoStats::add_written(data.size());
 }
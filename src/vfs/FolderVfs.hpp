@@ -1,6 +1,7 @@
 #pragma once
 #include "IVfs.hpp"
 #include <filesystem>
+#include <mutex>
 
 class FolderVfs : public IVfs {
 public:
@@ -17,11 +18,22 @@ public:
     void move(const std::filesystem::path& src, const std::filesystem::path& dst) override;
     StatInfo stat(const std::filesystem::path& path) const override;
     std::string readFile(const std::filesystem::path& path) const override;
+    size_t readFileRange(const std::filesystem::path& path, std::uint64_t offset, size_t count, std::string& out) const override;
     void writeFile(const std::filesystem::path& path, const std::string& data, bool append) override;
 
     const std::filesystem::path& root() const override { return root_; }
 
 private:
+    // The host root directory is created on the first mutating call rather
+    // than at construction, so read-only sessions never touch the disk.
+    void ensure_root() const;
+    // Canonical form of root_, computed once and reused by every
+    // resolveSecure() call.
+    const std::filesystem::path& canonical_root() const;
+
     std::filesystem::path root_;
+    mutable std::once_flag root_once_;
+    mutable std::once_flag canon_once_;
+    mutable std::filesystem::path root_can_;
 };
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -17,6 +18,12 @@ struct StatInfo {
     std::filesystem::file_time_type mtime;
 };
 
+// Thread-safety contract: one IVfs instance is shared by every session in
+// a process, so all methods may be called concurrently from multiple
+// threads. const methods must not modify shared state without internal
+// synchronization. Operations on different paths are independent. Calls
+// that race on the same path get host-filesystem semantics (for example,
+// the last writeFile wins); nothing is atomic across calls.
 class IVfs {
 public:
     virtual ~IVfs() = default;
@@ -32,6 +39,10 @@ public:
     virtual void move(const std::filesystem::path& src, const std::filesystem::path& dst) = 0;
     virtual StatInfo stat(const std::filesystem::path& path) const = 0;
     virtual std::string readFile(const std::filesystem::path& path) const = 0;
+    // Appends up to `count` bytes from `offset` on to `out` and returns how
+    // many; fewer than `count` only at the end of the file. For readers
+    // that may stop early without reading the whole file.
+    virtual size_t readFileRange(const std::filesystem::path& path, std::uint64_t offset, size_t count, std::string& out) const = 0;
     virtual void writeFile(const std::filesystem::path& path, const std::string& data, bool append) = 0;
 
     virtual const std::filesystem::path& root() const = 0;
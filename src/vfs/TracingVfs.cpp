@@ -0,0 +1,58 @@
+#include "TracingVfs.hpp"
+#include "../core/Trace.hpp"
+
+std::filesystem::path TracingVfs::resolveSecure(const std::filesystem::path& cwd,
+                                                const std::filesystem::path& input) const {
+    Trace::Span span("vfs", "resolveSecure", Trace::label(input));
+    return inner_.resolveSecure(cwd, input);
+}
+
+std::vector<DirEntry> TracingVfs::list(const std::filesystem::path& path) const {
+    Trace::Span span("vfs", "list", Trace::label(path));
+    return inner_.list(path);
+}
+
+void TracingVfs::touch(const std::filesystem::path& path) {
+    Trace::Span span("vfs", "touch", Trace::label(path));
+    inner_.touch(path);
+}
+
+void TracingVfs::mkdir(const std::filesystem::path& path, bool recursive) {
+    Trace::Span span("vfs", "mkdir", Trace::label(path));
+    inner_.mkdir(path, recursive);
+}
+
+void TracingVfs::remove(const std::filesystem::path& path, bool recursive) {
+    Trace::Span span("vfs", "remove", Trace::label(path));
+    inner_.remove(path, recursive);
+}
+
+void TracingVfs::copy(const std::filesystem::path& src, const std::filesystem::path& dst, bool recursive) {
+    Trace::Span span("vfs", "copy", Trace::label(src));
+    inner_.copy(src, dst, recursive);
+}
+
+void TracingVfs::move(const std::filesystem::path& src, const std::filesystem::path& dst) {
+    Trace::Span span("vfs", "move", Trace::label(src));
+    inner_.move(src, dst);
+}
+
+StatInfo TracingVfs::stat(const std::filesystem::path& path) const {
+    Trace::Span span("vfs", "stat", Trace::label(path));
+    return inner_.stat(path);
+}
+
+std::string TracingVfs::readFile(const std::filesystem::path& path) const {
+    Trace::Span span("vfs", "readFile", Trace::label(path));
+    return inner_.readFile(path);
+}
+
+size_t TracingVfs::readFileRange(const std::filesystem::path& path, std::uint64_t offset, size_t count, std::string& out) const {
+    Trace::Span span("vfs", "readFileRange", Trace::label(path));
+    return inner_.readFileRange(path, offset, count, out);
+}
+
+void TracingVfs::writeFile(const std::filesystem::path& path, const std::string& data, bool append) {
+    Trace::Span span("vfs", "writeFile", Trace::label(path));
+    inner_.writeFile(path, data, append);
+}
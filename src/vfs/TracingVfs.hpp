@@ -0,0 +1,29 @@
+#pragma once
+#include "IVfs.hpp"
+
+// IVfs decorator that records a trace span around every call to the
+// wrapped VFS. Installed by main only when CORTEX_TRACE is set, so untraced
+// runs pay nothing.
+class TracingVfs : public IVfs {
+public:
+    explicit TracingVfs(IVfs& inner) : inner_(inner) {}
+
+    std::filesystem::path resolveSecure(const std::filesystem::path& cwd,
+                                        const std::filesystem::path& input) const override;
+
+    std::vector<DirEntry> list(const std::filesystem::path& path) const override;
+    void touch(const std::filesystem::path& path) override;
+    void mkdir(const std::filesystem::path& path, bool recursive) override;
+    void remove(const std::filesystem::path& path, bool recursive) override;
+    void copy(const std::filesystem::path& src, const std::filesystem::path& dst, bool recursive) override;
+    void move(const std::filesystem::path& src, const std::filesystem::path& dst) override;
+    StatInfo stat(const std::filesystem::path& path) const override;
+    std::string readFile(const std::filesystem::path& path) const override;
+    size_t readFileRange(const std::filesystem::path& path, std::uint64_t offset, size_t count, std::string& out) const override;
+    void writeFile(const std::filesystem::path& path, const std::string& data, bool append) override;
+
+    const std::filesystem::path& root() const override { return inner_.root(); }
+
+private:
+    IVfs& inner_;
+};
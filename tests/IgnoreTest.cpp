@@ -0,0 +1,75 @@
+// Checks ignore::Rules against paths whose git verdict is known. Exits
+// non-zero if any case fails.
+#include "util/Ignore.hpp"
+
+#include <iostream>
+#include <optional>
+
+namespace {
+
+enum class Verdict { None, Excluded, Included };
+
+struct Case {
+    const char* rules;
+    const char* path;
+    bool is_dir;
+    Verdict expected;
+};
+
+const Case kCases[] = {
+    // No '/': the name at any depth
+    {"*.log", "a.log", false, Verdict::Excluded},
+    {"*.log", "x/y/a.log", false, Verdict::Excluded},
+    {"*.log", "a.txt", false, Verdict::None},
+    {"build", "src/build", true, Verdict::Excluded},
+    // A trailing '/': directories only
+    {"build/", "build", true, Verdict::Excluded},
+    {"build/", "build", false, Verdict::None},
+    {"build/", "src/build", true, Verdict::Excluded},
+    // A '/' elsewhere anchors to the file's directory
+    {"/out", "out", true, Verdict::Excluded},
+    {"/out", "src/out", true, Verdict::None},
+    {"docs/*.tmp", "docs/a.tmp", false, Verdict::Excluded},
+    {"docs/*.tmp", "x/docs/a.tmp", false, Verdict::None},
+    {"docs/*.tmp", "docs/sub/a.tmp", false, Verdict::None},
+    // '**'
+    {"**/cache", "cache", true, Verdict::Excluded},
+    {"**/cache", "a/b/cache", true, Verdict::Excluded},
+    {"a/**/b", "a/b", false, Verdict::Excluded},
+    {"a/**/b", "a/x/y/b", false, Verdict::Excluded},
+    {"a/**/b", "c/a/b", false, Verdict::None},
+    {"foo/**", "foo/x", false, Verdict::Excluded},
+    {"foo/**", "foo/x/y", false, Verdict::Excluded},
+    {"foo/**", "foo", true, Verdict::None},
+    // Negation: the last matching line wins
+    {"*.log\n!keep.log", "keep.log", false, Verdict::Included},
+    {"*.log\n!keep.log", "other.log", false, Verdict::Excluded},
+    {"!keep.log\n*.log", "keep.log", false, Verdict::Excluded},
+    {"foo/**\n!foo/keep.txt", "foo", true, Verdict::None},
+    {"foo/**\n!foo/keep.txt", "foo/keep.txt", false, Verdict::Included},
+    {"foo/**\n!foo/keep.txt", "foo/drop.txt", false, Verdict::Excluded},
+    // Comments, blank lines, escaped trailing spaces
+    {"# *.c\n\n", "a.c", false, Verdict::None},
+    {"a\\ ", "a ", false, Verdict::Excluded},
+};
+
+const char* name(Verdict v) {
+    return v == Verdict::None ? "none" : v == Verdict::Excluded ? "excluded" : "included";
+}
+
+}
+
+int main() {
+    int failures = 0;
+    for (const auto& c : kCases) {
+        std::optional<bool> r = ignore::Rules(c.rules).match(c.path, c.is_dir);
+        Verdict got = !r ? Verdict::None : *r ? Verdict::Excluded : Verdict::Included;
+        if (got != c.expected) {
+            std::cerr << "FAIL: rules \"" << c.rules << "\" path " << c.path << (c.is_dir ? "/" : "")
+                      << "\n  expected: " << name(c.expected) << "\n  got:      " << name(got) << '\n';
+            ++failures;
+        }
+    }
+    std::cerr << (sizeof(kCases) / sizeof(kCases[0]) - failures) << " passed, " << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+// Builds and updates a trigram index over a random tree and checks that
+// grep -r prints the same with the index as without it: right after
+// building, after files change behind its back, and after updates that
+// reuse and renumber files. A small spill threshold makes every build
+// merge several segments. Exits non-zero if any case fails.
+#include "core/Environment.hpp"
+#include "shell/Shell.hpp"
+#include "util/TrigramIndex.hpp"
+#include "vfs/FolderVfs.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Small enough that every few files spill a segment
+constexpr size_t kTestSpillBytes = 2048;
+
+const char* const kWords[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+                              "india", "juliet", "kilo", "lima", "mike", "november"};
+constexpr size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+// Each line is a run of words, so most files miss most words and the
+// index has something to rule out.
+const char* const kQueries[] = {
+    "grep -r alpha /t",       "grep -r golf /t",      "grep -ri JULIET /t",      "grep -r -l kilo /t",
+    "grep -r -E 'lima|mike' /t", "grep -r zzzz /t",   "grep -r hotel /t/d1",     "grep -r -c echo /t/d1/d2",
+    "grep -r november /t/d3", "grep -r 'foxtrot golf' /t",
+};
+
+fs::path root;
+int failures = 0;
+int checks = 0;
+
+std::string run(const std::string& script) {
+    FolderVfs vfs(root);
+    Environment env;
+    std::istringstream in;
+    std::ostringstream out;
+    Shell shell(in, out, vfs, env);
+    shell.run_command(script);
+    return out.str();
+}
+
+std::string random_text(std::mt19937& rng) {
+    std::string s;
+    for (int line = 0, lines = 1 + static_cast<int>(rng() % 6); line < lines; ++line) {
+        for (int w = 0, words = 1 + static_cast<int>(rng() % 3); w < words; ++w)
+            s += std::string(w ? " " : "") + kWords[rng() % (kWordCount / 2 + line)];
+        s += '\n';
+    }
+    return s;
+}
+
+const char* const kDirs[] = {"t", "t/d1", "t/d1/d2", "t/d3", "t/d3/d4"};
+
+fs::path random_file(std::mt19937& rng) {
+    return root / kDirs[rng() % (sizeof(kDirs) / sizeof(kDirs[0]))] / ("f" + std::to_string(rng() % 40) + ".txt");
+}
+
+void write_file(const fs::path& p, const std::string& text) {
+    fs::create_directories(p.parent_path());
+    std::ofstream(p, std::ios::binary | std::ios::trunc) << text;
+}
+
+std::vector<fs::path> files_under(const fs::path& dir) {
+    std::vector<fs::path> files;
+    for (const auto& e : fs::recursive_directory_iterator(dir))
+        if (e.is_regular_file()) files.push_back(e.path());
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Changes, adds and removes files. Every change alters the size too, so
+// it shows whatever the mtime resolution.
+void mutate(std::mt19937& rng) {
+    std::vector<fs::path> files = files_under(root / "t");
+    for (const auto& f : files) {
+        switch (rng() % 6) {
+        case 0: {
+            std::string text;
+            { std::ifstream in(f, std::ios::binary); text.assign(std::istreambuf_iterator<char>(in), {}); }
+            write_file(f, text + random_text(rng));
+            break;
+        }
+        case 1: fs::remove(f); break;
+        default: break;
+        }
+    }
+    for (int i = 0; i < 8; ++i) {
+        fs::path f = random_file(rng);
+        if (!fs::exists(f)) write_file(f, random_text(rng));
+    }
+}
+
+std::string grep_all() {
+    std::string out;
+    for (const char* q : kQueries) out += std::string("$ ") + q + '\n' + run(q);
+    return out;
+}
+
+// Output of the queries with the index moved out of the way.
+std::string grep_without_index(const fs::path& index) {
+    fs::path aside = fs::path(index).concat(".aside");
+    fs::rename(index, aside);
+    std::string out = grep_all();
+    fs::rename(aside, index);
+    return out;
+}
+
+void check_same(const std::string& step, const fs::path& index) {
+    ++checks;
+    std::string want = grep_without_index(index), got = grep_all();
+    if (got != want) {
+        std::cerr << "FAIL: " << step << "\n  without the index:\n" << want << "  with it:\n" << got << '\n';
+        ++failures;
+    }
+}
+
+void check(const std::string& step, bool ok) {
+    ++checks;
+    if (!ok) {
+        std::cerr << "FAIL: " << step << '\n';
+        ++failures;
+    }
+}
+
+}
+
+int main() {
+#ifdef _WIN32
+    root = fs::temp_directory_path() / "cortex_index_test";
+#else
+    root = fs::temp_directory_path() / ("cortex_index_test." + std::to_string(::getpid()));
+#endif
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root);
+
+    std::mt19937 rng(4242);
+    for (int i = 0; i < 60; ++i) write_file(random_file(rng), random_text(rng));
+
+    FolderVfs vfs(root);
+    CancelToken cancel;
+    const fs::path index = vfs.resolveSecure("/", trigram::index_path("/t"));
+
+    auto stats = trigram::build(vfs, "/t", false, cancel, kTestSpillBytes);
+    check("build", stats && stats->files == files_under(root / "t").size() && stats->segments > 1);
+    check_same("after build", index);
+    // Not vacuous: the subdirectory is covered and a missing word rules
+    // its files out
+    auto covering = trigram::Index::covering(vfs, "/t/d1");
+    check("covering index", covering && covering->root() == "/t");
+    if (covering) {
+        covering->narrow({"zzzz"});
+        const fs::path first = files_under(root / "t" / "d1")[0];
+        check("the index rules out files",
+              covering->excludes(first.lexically_relative(root / "t").generic_string(), first));
+    }
+
+    for (int round = 0; round < 4; ++round) {
+        const std::string r = " (round " + std::to_string(round) + ")";
+        mutate(rng);
+        check_same("stale index" + r, index);
+        stats = trigram::build(vfs, "/t", true, cancel, kTestSpillBytes);
+        check("update" + r, stats && stats->files == files_under(root / "t").size() && stats->reused > 0 &&
+                                stats->reused < stats->files);
+        check_same("after update" + r, index);
+    }
+
+    // A file replaced by a directory of the same name
+    fs::path f = files_under(root / "t/d3")[0];
+    fs::remove(f);
+    write_file(f / "inner.txt", "alpha hotel november\n");
+    check_same("file turned into a directory", index);
+    stats = trigram::build(vfs, "/t", true, cancel, kTestSpillBytes);
+    check_same("after update of the directory", index);
+
+    // A full rebuild without the spill gives the same index contents
+    stats = trigram::build(vfs, "/t", false, cancel);
+    check("build without spilling", stats && stats->segments == 1);
+    check_same("after build without spilling", index);
+
+    fs::remove_all(root, ec);
+    std::cerr << checks - failures << " passed, " << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
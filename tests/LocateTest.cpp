@@ -0,0 +1,127 @@
+// Checks incremental locate::build against full rebuilds: after each
+// change the incremental database must hold the same paths, types and
+// mtimes as a full one while listing only the directories that changed.
+// Exits non-zero if any case fails.
+#include "util/LocateDb.hpp"
+#include "vfs/FolderVfs.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path root;
+int failures = 0;
+int checks = 0;
+
+void check(const std::string& step, bool ok, const std::string& detail = "") {
+    ++checks;
+    if (!ok) {
+        std::cerr << "FAIL: " << step << '\n' << detail;
+        ++failures;
+    }
+}
+
+// One line per path: path, type and, for a directory, its mtime. That of
+// /var/lib is left out: writing the database changes it.
+std::string dump() {
+    std::ostringstream out;
+    locate::Database db(root / "var" / "lib" / "locate.db");
+    locate::Reader r = db.reader();
+    while (r.next()) {
+        out << r.path() << ' ' << static_cast<int>(r.type());
+        if (r.type() == walk::Type::Dir && r.path() != "/var/lib") out << ' ' << r.mtime();
+        out << '\n';
+    }
+    return out.str();
+}
+
+// Directory mtimes are set by hand after each change, so a change shows
+// however coarse the file system's clock is.
+void bump(const fs::path& dir, int step) {
+    fs::last_write_time(dir, fs::file_time_type::clock::now() + std::chrono::seconds(step));
+}
+
+void write_file(const fs::path& p, const std::string& text) { std::ofstream(p, std::ios::binary) << text; }
+
+// An incremental build, then a full one to compare it with.
+void update(const std::string& step, std::uint64_t want_read) {
+    FolderVfs vfs(root);
+    CancelToken cancel;
+    auto stats = locate::build(vfs, true, cancel);
+    const std::string got = dump();
+    check(step + ": updatedb", stats.has_value());
+    if (!stats) return;
+    check(step + ": directories read", stats->dirs_read == want_read,
+          "  expected: " + std::to_string(want_read) + "\n  got:      " + std::to_string(stats->dirs_read) + '\n');
+    auto full = locate::build(vfs, false, cancel);
+    const std::string want = dump();
+    check(step + ": same as a full build", full && got == want,
+          "  full:\n" + want + "  incremental:\n" + got);
+}
+
+}
+
+int main() {
+#ifdef _WIN32
+    root = fs::temp_directory_path() / "cortex_locate_test";
+#else
+    root = fs::temp_directory_path() / ("cortex_locate_test." + std::to_string(::getpid()));
+#endif
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "a" / "b" / "c");
+    fs::create_directories(root / "d");
+    write_file(root / "a" / "f", "f\n");
+    write_file(root / "a" / "b" / "g", "g\n");
+    write_file(root / "a" / "b" / "c" / "h", "h\n");
+    write_file(root / "d" / "i", "i\n");
+    write_file(root / "a-b", "x\n");
+    {
+        FolderVfs vfs(root);
+        CancelToken cancel;
+        auto stats = locate::build(vfs, false, cancel);
+        check("first build", stats && stats->dirs_read == stats->dirs);
+    }
+    int step = 0;
+    // /var/lib changes with every build: the database is replaced
+    update("nothing changed", 1);
+
+    // A changed subdirectory is read; its parent and siblings are not
+    write_file(root / "a" / "b" / "new", "n\n");
+    bump(root / "a" / "b", ++step);
+    update("file added in a/b", 2);
+
+    fs::remove(root / "a" / "b" / "c" / "h");
+    bump(root / "a" / "b" / "c", ++step);
+    update("file removed in a/b/c", 2);
+
+    // A file turned into a directory: the parent lists a directory where
+    // the old database has a file, and the new directory has no previous
+    // entry to reuse
+    fs::remove(root / "a" / "f");
+    fs::create_directories(root / "a" / "f" / "sub");
+    write_file(root / "a" / "f" / "sub" / "j", "j\n");
+    bump(root / "a", ++step);
+    update("file turned into a directory", 4);
+
+    // And back
+    fs::remove_all(root / "a" / "f");
+    write_file(root / "a" / "f", "f\n");
+    bump(root / "a", ++step);
+    update("directory turned into a file", 2);
+
+    fs::remove_all(root, ec);
+    std::cerr << checks - failures << " passed, " << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
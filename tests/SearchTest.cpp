@@ -0,0 +1,206 @@
+// Checks search::Finder, search::MultiFinder and regex::Regex against
+// naive searches and std::regex on seeded random input. Haystack lengths
+// run past 64 bytes from every start offset, so the AVX2 and SSE2 loops
+// and the tails they hand over to are all exercised. Exits non-zero if
+// any case fails.
+#include "util/Regex.hpp"
+#include "util/Search.hpp"
+
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t npos = std::string_view::npos;
+
+int failures = 0;
+int checks = 0;
+
+void fail(const std::string& what, const std::string& hay, size_t expected, size_t got) {
+    if (++failures > 20) return; // enough to go on
+    std::cerr << "FAIL: " << what << " in \"" << hay << "\"\n  expected: "
+              << (expected == npos ? std::string("npos") : std::to_string(expected))
+              << "\n  got:      " << (got == npos ? std::string("npos") : std::to_string(got)) << '\n';
+}
+
+void check(const std::string& what, const std::string& hay, size_t expected, size_t got) {
+    ++checks;
+    if (expected != got) fail(what, hay, expected, got);
+}
+
+bool equal_at(const std::string& hay, size_t at, const std::string& needle, bool icase) {
+    if (hay.size() - at < needle.size()) return false;
+    for (size_t k = 0; k < needle.size(); ++k) {
+        char a = hay[at + k], b = needle[k];
+        if (icase) {
+            a = static_cast<char>(std::tolower(static_cast<unsigned char>(a)));
+            b = static_cast<char>(std::tolower(static_cast<unsigned char>(b)));
+        }
+        if (a != b) return false;
+    }
+    return true;
+}
+
+size_t naive_find(const std::string& hay, size_t from, const std::string& needle, bool icase) {
+    for (size_t i = from; i + needle.size() <= hay.size(); ++i)
+        if (equal_at(hay, i, needle, icase)) return i;
+    return npos;
+}
+
+// The match that ends first, then the lowest needle index.
+size_t naive_multi(const std::string& hay, size_t from, const std::vector<std::string>& needles, bool icase,
+                   size_t& which) {
+    for (size_t end = from; end <= hay.size(); ++end)
+        for (size_t k = 0; k < needles.size(); ++k) {
+            const size_t n = needles[k].size();
+            if (n <= end - from && equal_at(hay, end - n, needles[k], icase)) {
+                which = k;
+                return end - n;
+            }
+        }
+    return npos;
+}
+
+std::string random_text(std::mt19937& rng, size_t len, const std::string& alphabet) {
+    std::string s(len, ' ');
+    for (auto& c : s) c = alphabet[rng() % alphabet.size()];
+    return s;
+}
+
+void finder_cases(std::mt19937& rng) {
+    // Few distinct bytes, so first/last-byte candidates that fail the full
+    // compare are common.
+    const std::string alphabet = "abAB.\xC3\xA9";
+    for (int round = 0; round < 400; ++round) {
+        const bool icase = round % 2;
+        std::string needle = random_text(rng, 1 + rng() % 6, alphabet);
+        std::string hay = random_text(rng, rng() % 100, alphabet);
+        if (!hay.empty() && rng() % 2) hay.replace(rng() % hay.size(), 0, needle); // plant a match
+        search::Finder finder(needle, icase);
+        for (size_t from = 0; from <= hay.size(); ++from)
+            check("Finder(\"" + needle + "\"" + (icase ? ", icase" : "") + ") from " + std::to_string(from), hay,
+                  naive_find(hay, from, needle, icase), finder.find(hay, from));
+    }
+}
+
+void multi_finder_cases(std::mt19937& rng) {
+    for (int round = 0; round < 300; ++round) {
+        const bool icase = round % 2;
+        // Wider alphabets go past kMaxSkipBytes start bytes, which turns the
+        // vector skip off.
+        const std::string alphabet = round % 3 ? "abcAB" : "abcdefghijkABCD";
+        std::vector<std::string> needles(1 + rng() % 12);
+        for (auto& n : needles) n = random_text(rng, 1 + rng() % 5, alphabet);
+        std::string hay = random_text(rng, rng() % 100, alphabet);
+        search::MultiFinder finder(needles, icase);
+        std::string what = "MultiFinder(";
+        for (const auto& n : needles) what += "\"" + n + "\" ";
+        what += icase ? "icase)" : ")";
+        for (size_t from = 0; from <= hay.size(); ++from) {
+            size_t want_which = 0, got_which = 0;
+            size_t want = naive_multi(hay, from, needles, icase, want_which);
+            size_t got = finder.find(hay, from, got_which);
+            check(what + " from " + std::to_string(from), hay, want, got);
+            if (want != npos && got == want) check(what + " needle index", hay, want_which, got_which);
+        }
+    }
+}
+
+// Patterns std::regex reads the same way in its POSIX extended grammar.
+const char* const kPatterns[] = {
+    "ab",        "a.c",        "^ab",          "ab$",         "^$",          "a*b",        "a+b+",
+    "ab?c",      "(ab)+c",     "a|bc|cab",     "a{2}",        "a{2,}b",      "(a|b){2,3}c", "[abc]{3}",
+    "[^a]b",     "[[:digit:]]+x", "x[0-9]{1,2}$", "^(a|b)*$",  "c(a|b)*c",    "ERROR [0-9]+ ms", "b.*a.*c",
+};
+
+void regex_cases(std::mt19937& rng) {
+    const std::string alphabet = "abcxABC0129 ERORms";
+    for (const char* pattern : kPatterns) {
+        for (bool icase : {false, true}) {
+            regex::Regex re(pattern, icase);
+            auto flags = std::regex::extended | (icase ? std::regex::icase : std::regex::flag_type{});
+            std::regex ref(pattern, flags);
+            std::string data;
+            std::vector<size_t> starts;
+            std::vector<bool> hits;
+            for (int line = 0; line < 200; ++line) {
+                std::string text = random_text(rng, rng() % 40, alphabet);
+                if (line % 10 == 0) text = "ERROR " + std::to_string(rng() % 1000) + " ms";
+                bool want = std::regex_search(text, ref);
+                check(std::string("Regex(\"") + pattern + "\"" + (icase ? ", icase" : "") + ").match_line", text,
+                      want, re.match_line(text));
+                starts.push_back(data.size());
+                hits.push_back(want);
+                data += text;
+                data += '\n';
+            }
+            for (size_t i = 0; i < starts.size(); ++i) {
+                size_t want = npos;
+                for (size_t j = i; j < starts.size() && want == npos; ++j)
+                    if (hits[j]) want = starts[j];
+                ++checks;
+                size_t got = re.find_line(data, starts[i]);
+                if (got != want)
+                    fail(std::string("Regex(\"") + pattern + "\").find_line from line " + std::to_string(i),
+                         "<" + std::to_string(data.size()) + " bytes>", want, got);
+            }
+        }
+    }
+}
+
+// "a(a|b){12}$" needs a DFA state for each of the 2^13 values of the last
+// 13 bytes, past Regex::kMaxStates, so long random lines make the state
+// cache fill up and be cleared mid-line, over and over. A line matches
+// when its 13th byte from the end is an 'a'.
+void cache_reset_cases(std::mt19937& rng) {
+    static_assert(regex::Regex::kMaxStates < (1u << 13), "the pattern must outgrow the cache");
+    regex::Regex re("a(a|b){12}$");
+    for (int round = 0; round < 40; ++round) {
+        std::string line = random_text(rng, 2000 + rng() % 3000, "ab");
+        bool want = line[line.size() - 13] == 'a';
+        check("Regex(\"a(a|b){12}$\").match_line", "<" + std::to_string(line.size()) + " bytes>", want,
+              re.match_line(line));
+    }
+}
+
+void syntax_cases() {
+    const char* const kBad[] = {"a{256}", "a{1000}", "a{99999}", "a{1,99999}", "a{99999999999999999999}",
+                                "a{3,2}", "(a"};
+    for (const char* pattern : kBad) {
+        ++checks;
+        try {
+            regex::Regex re(pattern);
+            fail(std::string("Regex(\"") + pattern + "\") did not throw", "", 1, 0);
+        } catch (const std::runtime_error&) {
+        }
+    }
+    // Not an interval, so the braces are literal, as in grep
+    struct Literal {
+        const char* pattern;
+        const char* line;
+    };
+    const Literal kLiteral[] = {{"a{", "a{"}, {"a{x}", "a{x}"}, {"a{1", "a{1"}, {"{1}", "{1}"}, {"a{255}", nullptr}};
+    for (const auto& c : kLiteral) {
+        regex::Regex re(c.pattern);
+        std::string line = c.line ? c.line : std::string(255, 'a');
+        check(std::string("Regex(\"") + c.pattern + "\").match_line", line, true, re.match_line(line));
+    }
+}
+
+}
+
+int main() {
+    std::mt19937 rng(20240607);
+    finder_cases(rng);
+    multi_finder_cases(rng);
+    regex_cases(rng);
+    cache_reset_cases(rng);
+    syntax_cases();
+    std::cerr << checks - failures << " passed, " << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
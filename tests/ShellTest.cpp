@@ -0,0 +1,96 @@
+// Runs command lines through a Shell on a scratch VFS and checks their
+// output. Exits non-zero if any case fails.
+#include "core/Environment.hpp"
+#include "shell/Shell.hpp"
+#include "vfs/FolderVfs.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Case {
+    const char* script;   // one or more lines
+    const char* expected; // the script's whole output
+};
+
+// Word expansion: quoting must limit what is expanded however the quoted
+// and unquoted parts of a word are mixed.
+const Case kCases[] = {
+    {"X=hi\necho \"$X\"done", "hidone\n"},
+    {"A=1\nB=2\necho $B'$A'", "2$A\n"},
+    {"A=1\nB=2\necho \\$A$B", "$A2\n"},
+    {"A=1\necho \"$A\"'$A'\\$A$A", "1$A$A1\n"},
+    {"A=1\necho ${A}x \"${A}\"x '${A}'x", "1x 1x ${A}x\n"},
+    {"A='a b'\necho \"[$A]\"", "[a b]\n"},
+    {"echo \"\\$HOME\" '$?' \"$?\"", "$HOME $? 0\n"},
+    // Command substitution follows the same quoting, and its output is
+    // never taken as a glob pattern
+    {"echo '$(echo no)'$(echo yes)", "$(echo no)yes\n"},
+    {"echo \"$(echo a b)\"'`echo c`'`echo d`", "a b`echo c`d\n"},
+    {"mkdir /g\ntouch /g/axb\ntouch '/g/a*b'\necho /g/$(echo a)*", "/g/a*b /g/axb\n"},
+    {"mkdir /h\ntouch /h/axb\necho /h/\"$(echo 'a*b')\" /h/$(echo '?')xb /h/*$(echo '?')", "/h/a*b /h/?xb /h/*?\n"},
+    // A variable's wildcards count only in a word with a typed one
+    {"mkdir /v\ntouch /v/a.txt\ncd /v\nX='*.txt'\necho $X $X* \"$X\"*", "*.txt a.txt *.txt*\n"},
+    // A '[' without its ']' is a literal, so the test builtin is left alone
+    {"mkdir /k\ntouch /k/axb\ntouch '/k/['\ncd /k\n[ a = a ]\necho $?\necho [ a ] [x x[ /k/[*", "0\n[ a ] [x x[ /k/[\n"},
+    {"mkdir /m\ntouch /m/axb\ncd /m\n[ -f axb ]\necho $? [ [a$(echo b)", "0 [ [ab\n"},
+    // Option checks
+    {"grep -r -j 0 x /\ngrep -r -j -2 x /", "grep: invalid -j count: 0\ngrep: invalid -j count: -2\n"},
+    {"mkdir /w\nmkdir /w/a\necho x > /w/a/f\necho x > /w/f\ntimeout 0 grep -r -j 2 zzzz /w > /w.out\necho $?", "124\n"},
+    {"timeout inf echo a\ntimeout nan echo b\ntimeout 1e300 echo c", "timeout: invalid duration: inf\ntimeout: invalid duration: nan\nc\n"},
+    {"find / -j 0\nfind / -j -1", "find: unknown or malformed option: -j\nfind: unknown or malformed option: -j\n"},
+    {"mkdir /s\necho hi > /s/f\ngrep hi /s/f /nope\necho $?\ngrep -l hi /s/f /nope\necho $?\ngrep -q hi /nope /s/f\necho $?", "/s/f:hi\ngrep: cannot access: /nope\n2\n/s/f\ngrep: cannot access: /nope\n2\ngrep: cannot access: /nope\n0\n"},
+    {"mkdir /d\nmkdir /d/e\ntouch /d/e/f\ncd /d/e\nfind . -delete\ncd /d\nfind /d/e -delete\nfind / -name e -type d\nfind /d", "/d/e\n/d\n/d/e\n"},
+    {"mkdir /i\nmkdir /i/foo\necho needle > /i/foo/keep.txt\necho needle > /i/foo/drop.txt\necho 'foo/**' > /i/.gitignore\necho '!foo/keep.txt' >> /i/.gitignore\ngrep -r needle /i", "/i/foo/keep.txt:needle\n"},
+    // find: -exec batches in tree order whatever -j does; /aged is set up
+    // by main() with old.txt ten days old
+    {"touch /x/e.txt\ntouch /x/c/d/3.txt\ntouch /x/b/2.txt\ntouch /x/a/1.txt\nfind /x -name '*.txt' -j 4 -exec echo {} +", "/x/a/1.txt /x/b/2.txt /x/c/d/3.txt /x/e.txt\n"},
+    {"find /aged -type f -mtime +7\nfind /aged -type f -mtime -1\nfind /aged -type f -newer /aged/old.txt", "/aged/old.txt\n/aged/new.txt\n/aged/new.txt\n"},
+    {"mkdir /q\necho hello > /q/f\necho -n > /q/-n\ngrep hello /q/f -n\ngrep -- -n /q/f /q/-n\ngrep hello /q -r --no-ignore", "/q/f:1:hello\n/q/-n:-n\n/q/f:hello\n"},
+};
+
+}
+
+int main() {
+#ifdef _WIN32
+    fs::path root = fs::temp_directory_path() / "cortex_shell_test";
+#else
+    fs::path root = fs::temp_directory_path() / ("cortex_shell_test." + std::to_string(::getpid()));
+#endif
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root);
+    // For -mtime and -newer, which the shell cannot set up
+    fs::create_directories(root / "aged");
+    std::ofstream(root / "aged" / "old.txt") << "old\n";
+    std::ofstream(root / "aged" / "new.txt") << "new\n";
+    fs::last_write_time(root / "aged" / "old.txt", fs::file_time_type::clock::now() - std::chrono::hours(24 * 10));
+
+    int failures = 0;
+    for (const auto& c : kCases) {
+        FolderVfs vfs(root);
+        Environment env;
+        std::istringstream in;
+        std::ostringstream out;
+        Shell shell(in, out, vfs, env);
+        shell.run_command(c.script);
+        if (out.str() != c.expected) {
+            std::cerr << "FAIL: " << c.script << "\n  expected: " << c.expected << "  got:      " << out.str() << '\n';
+            ++failures;
+        }
+    }
+    fs::remove_all(root, ec);
+    std::cerr << (sizeof(kCases) / sizeof(kCases[0]) - failures) << " passed, " << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}